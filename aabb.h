@@ -0,0 +1,57 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <math.h>
+#include "vector.h"
+
+// 轴对齐包围盒及BVH构建/遍历共用的辅助函数
+
+typedef struct {
+    vec3_t min;
+    vec3_t max;
+} aabb_t;
+
+// 比较式的min/max可直接编译为minss/maxss，fminf/fmaxf需处理NaN，通常是函数调用
+static inline float min_f(float a, float b) { return a < b ? a : b; }
+static inline float max_f(float a, float b) { return a > b ? a : b; }
+
+static inline aabb_t aabb_empty(void) {
+    return (aabb_t){{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+}
+
+static inline void aabb_grow(aabb_t* box, vec3_t lo, vec3_t hi) {
+    box->min.x = min_f(box->min.x, lo.x);
+    box->min.y = min_f(box->min.y, lo.y);
+    box->min.z = min_f(box->min.z, lo.z);
+    box->max.x = max_f(box->max.x, hi.x);
+    box->max.y = max_f(box->max.y, hi.y);
+    box->max.z = max_f(box->max.z, hi.z);
+}
+
+static inline float aabb_area(aabb_t box) {
+    if (box.min.x > box.max.x) return 0.0f;
+    float dx = box.max.x - box.min.x;
+    float dy = box.max.y - box.min.y;
+    float dz = box.max.z - box.min.z;
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static inline float vec3_axis(vec3_t v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// 光线与包围盒的slab测试，区间与[t_min, t_max]有交集时返回true
+static inline int ray_hits_aabb(vec3_t min, vec3_t max, vec3_t origin, vec3_t inv_dir,
+                                float t_min, float t_max) {
+    float tx0 = (min.x - origin.x) * inv_dir.x;
+    float tx1 = (max.x - origin.x) * inv_dir.x;
+    float ty0 = (min.y - origin.y) * inv_dir.y;
+    float ty1 = (max.y - origin.y) * inv_dir.y;
+    float tz0 = (min.z - origin.z) * inv_dir.z;
+    float tz1 = (max.z - origin.z) * inv_dir.z;
+    float t_enter = max_f(max_f(min_f(tx0, tx1), min_f(ty0, ty1)), max_f(min_f(tz0, tz1), t_min));
+    float t_exit = min_f(min_f(max_f(tx0, tx1), max_f(ty0, ty1)), min_f(max_f(tz0, tz1), t_max));
+    return t_enter <= t_exit;
+}
+
+#endif // AABB_H
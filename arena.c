@@ -0,0 +1,65 @@
+#include "arena.h"
+#include <stdlib.h>
+
+#define ARENA_MIN_BLOCK (64 * 1024)
+
+struct arena_block {
+    arena_block_t* next;
+    size_t capacity;
+    size_t offset;
+    _Alignas(ARENA_ALIGNMENT) unsigned char data[];
+};
+
+static arena_block_t* arena_new_block(size_t capacity) {
+    // aligned_alloc要求大小是对齐值的整数倍
+    size_t bytes = (sizeof(arena_block_t) + capacity + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    arena_block_t* block = aligned_alloc(ARENA_ALIGNMENT, bytes);
+    if (!block) return NULL;
+    block->next = NULL;
+    block->capacity = capacity;
+    block->offset = 0;
+    return block;
+}
+
+void* arena_alloc(arena_t* arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    arena_block_t* block = arena->blocks;
+    if (!block || block->capacity - block->offset < size) {
+        // 新块至少是上一块的两倍
+        size_t capacity = block ? block->capacity * 2 : ARENA_MIN_BLOCK;
+        if (capacity < size) capacity = size;
+        arena_block_t* fresh = arena_new_block(capacity);
+        if (!fresh) return NULL;
+        fresh->next = block;
+        arena->blocks = block = fresh;
+    }
+    void* p = block->data + block->offset;
+    block->offset += size;
+    arena->used += size;
+    return p;
+}
+
+void arena_reset(arena_t* arena) {
+    if (arena->used > arena->peak) arena->peak = arena->used;
+    arena->used = 0;
+    arena_block_t* block = arena->blocks;
+    if (block && block->next) {
+        // 本轮用了多个块：换成一个能容纳历史峰值的块
+        arena_free(arena);
+        size_t capacity = ARENA_MIN_BLOCK;
+        while (capacity < arena->peak) capacity *= 2;
+        arena->blocks = arena_new_block(capacity);
+        return;
+    }
+    if (block) block->offset = 0;
+}
+
+void arena_free(arena_t* arena) {
+    arena_block_t* block = arena->blocks;
+    while (block) {
+        arena_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+}
@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// 帧内临时内存的线性分配器：分配只移动指针，不能单独释放，arena_reset一次性回收
+// 当前内存块不够时按几何级数追加新块；reset时若用了多个块，合并为一个足够大的块，
+// 之后每帧用量不变时不再调用malloc
+
+typedef struct arena_block arena_block_t;
+
+typedef struct {
+    arena_block_t* blocks;      // 当前块在链表头部
+    size_t used;                // 自上次reset以来分配的总字节数（含对齐填充）
+    size_t peak;                // 历次reset前used的最大值
+} arena_t;
+
+// 按缓存行对齐，同时满足各种SIMD宽度（最宽为AVX-512的64字节）的对齐加载
+#define ARENA_ALIGNMENT 64
+
+// 返回按ARENA_ALIGNMENT对齐的size字节，失败时返回NULL
+void* arena_alloc(arena_t* arena, size_t size);
+
+// 回收本轮所有分配
+void arena_reset(arena_t* arena);
+
+// 释放所有内存块
+void arena_free(arena_t* arena);
+
+#endif // ARENA_H
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "display.h"
+#include "raster.h"
+#include "raytracer.h"
+#include "sphere_bvh.h"
+#include "scenes.h"
+#include "thread_pool.h"
+#include "timing.h"
+#include "texture.h"
+
+// 基准测试：无窗口渲染固定场景，以JSON格式输出吞吐量和帧时间分位数
+// 用法: tiny_renderer_bench [--frames N] [--warmup N] [--size WxH] [--threads N] [--filter TEXT] [--output PATH]
+
+typedef enum {
+    BENCH_RASTER,
+    BENCH_RASTER_MESH,
+    BENCH_RASTER_MESH_SHADED,
+    BENCH_RASTER_MESH_TEXTURED,
+    BENCH_RASTER_MESH_LIT_VERTEX,
+    BENCH_RASTER_MESH_LIT_PIXEL,
+    BENCH_RAYTRACE
+} bench_kind_t;
+
+typedef struct {
+    const char* name;
+    bench_kind_t kind;
+    int param;      // 网格边长（负数为8层重叠网格）、球体数或细分段数，含义由场景决定
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+    { "raster_cubes",                 BENCH_RASTER,   0 },
+    { "raster_cube_grid_4x4",         BENCH_RASTER,   4 },
+    { "raster_cube_grid_16x16",       BENCH_RASTER,   16 },
+    { "raster_cube_grid_64x64",       BENCH_RASTER,   64 },
+    { "raster_cube_layers_16x16x8",   BENCH_RASTER,   -16 },
+    { "raster_mesh_512k",             BENCH_RASTER_MESH, 512 },
+    { "raster_mesh_512k_shaded",      BENCH_RASTER_MESH_SHADED, 512 },
+    { "raster_mesh_32k_texture_4k",   BENCH_RASTER_MESH_TEXTURED, 128 },
+    { "raster_mesh_512k_lit_vertex",  BENCH_RASTER_MESH_LIT_VERTEX, 512 },
+    { "raster_mesh_512k_lit_pixel",   BENCH_RASTER_MESH_LIT_PIXEL, 512 },
+    { "raytrace_spheres",             BENCH_RAYTRACE, 0 },
+    { "raytrace_random_spheres_256",  BENCH_RAYTRACE, 256 },
+    { "raytrace_random_spheres_4096", BENCH_RAYTRACE, 4096 },
+    { "raytrace_random_spheres_65536", BENCH_RAYTRACE, 65536 },
+    { "raytrace_mesh_2k",             BENCH_RAYTRACE, -32 },
+    { "raytrace_mesh_32k",            BENCH_RAYTRACE, -128 },
+    { "raytrace_mesh_512k",           BENCH_RAYTRACE, -512 },
+};
+
+typedef struct {
+    int frames;
+    int warmup;
+    int threads;
+    const char* filter;
+    const char* output;
+} bench_options_t;
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+// 最近秩法求分位数，times须已排序
+static double percentile(const double* times, int count, double p) {
+    int rank = (int)(p / 100.0 * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return times[rank - 1];
+}
+
+// 带属性插值的着色：法向量与视线方向夹角的余弦调制三角形颜色，纹理坐标叠加棋盘格
+static uint32_t bench_shade(const fragment_t* fragment, uint32_t color, const void* uniforms) {
+    (void)uniforms;
+    const float* varyings = fragment->varyings;
+    float nx = varyings[0], ny = varyings[1], nz = varyings[2];
+    float len_sq = nx * nx + ny * ny + nz * nz;
+    float shade = len_sq > 0.0f ? -nz / sqrtf(len_sq) : 0.0f;
+    if (shade < 0.0f) shade = 0.0f;
+    if (((int)(varyings[3] * 32.0f) + (int)(varyings[4] * 16.0f)) & 1) shade *= 0.5f;
+    uint32_t r = (uint32_t)(((color >> 16) & 0xFF) * shade);
+    uint32_t g = (uint32_t)(((color >> 8) & 0xFF) * shade);
+    uint32_t b = (uint32_t)((color & 0xFF) * shade);
+    return (color & 0xFF000000) | (r << 16) | (g << 8) | b;
+}
+
+static const raster_shader_t bench_shader = {
+    RASTER_VARYING_NORMAL | RASTER_VARYING_UV, bench_shade, NULL, false
+};
+
+// 纹理场景：4096x4096的程序纹理，三线性采样，球面在屏幕上远小于纹理（缩小）
+#define BENCH_TEXTURE_SIZE 4096
+static texture_t bench_texture;
+static texture_shader_params_t bench_texture_params = {&bench_texture, TEXTURE_FILTER_TRILINEAR};
+static const raster_shader_t bench_texture_shader = {
+    RASTER_VARYING_UV, texture_fragment_shader, &bench_texture_params, true
+};
+
+// 光照场景：使用光线追踪默认场景的光源，镜面指数取红色球体的500
+#define BENCH_SPECULAR 500.0f
+
+static bool create_bench_texture(void) {
+    uint32_t* pixels = malloc(sizeof(uint32_t) * BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE);
+    if (!pixels) return false;
+    for (int y = 0; y < BENCH_TEXTURE_SIZE; y++) {
+        for (int x = 0; x < BENCH_TEXTURE_SIZE; x++) {
+            uint32_t c = ((x >> 6) + (y >> 6)) & 1 ? 0xFFE0E0E0 : 0xFF303090;
+            pixels[(size_t)BENCH_TEXTURE_SIZE * y + x] = c ^ (uint32_t)((x * 7 + y * 13) & 0x1F);
+        }
+    }
+    bool ok = texture_create(&bench_texture, pixels, BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE);
+    free(pixels);
+    return ok;
+}
+
+static bool setup_case(const bench_case_t* c, raster_scene_t* raster_scene, uint64_t* scene_triangles) {
+    *scene_triangles = 0;
+    if (c->kind != BENCH_RAYTRACE) {
+        bool ok = c->kind != BENCH_RASTER ? raster_scene_mesh(raster_scene, c->param)
+                : c->param > 0 ? raster_scene_cube_grid(raster_scene, c->param)
+                : c->param < 0 ? raster_scene_cube_layers(raster_scene, -c->param, 8)
+                : raster_scene_cubes(raster_scene);
+        if (ok && c->kind == BENCH_RASTER_MESH_TEXTURED && !create_bench_texture()) {
+            raster_scene_free(raster_scene);
+            ok = false;
+        }
+        if (!ok) return false;
+        for (int i = 0; i < raster_scene->instance_count; i++) {
+            *scene_triangles += raster_scene->instances[i].model->triangle_count;
+        }
+        return true;
+    }
+    if (c->param == 0) {
+        raytrace_scene_spheres();
+        return true;
+    }
+    if (c->param > 0) return raytrace_scene_random_spheres(c->param, 1);
+    int segments = -c->param;
+    *scene_triangles = (uint64_t)2 * segments * segments;
+    return raytrace_scene_mesh(segments);
+}
+
+static void render_case(const bench_case_t* c, const raster_scene_t* raster_scene, thread_pool_t* pool) {
+    clear_color_buffer(0xFF000000);
+    if (c->kind != BENCH_RAYTRACE) {
+        set_raster_shader(c->kind == BENCH_RASTER_MESH_SHADED ? &bench_shader
+                          : c->kind == BENCH_RASTER_MESH_TEXTURED ? &bench_texture_shader : NULL);
+        set_raster_lighting(c->kind == BENCH_RASTER_MESH_LIT_VERTEX ? RASTER_LIGHTING_VERTEX
+                            : c->kind == BENCH_RASTER_MESH_LIT_PIXEL ? RASTER_LIGHTING_PIXEL : RASTER_LIGHTING_OFF,
+                            default_lights, NUM_LIGHTS, BENCH_SPECULAR);
+        raster_scene_render(raster_scene);
+    } else {
+        raytracer_render_frame(pool);
+    }
+}
+
+static bool run_case(FILE* out, const bench_case_t* c, const bench_options_t* options,
+                     thread_pool_t* pool, bool first) {
+    raster_scene_t raster_scene = {0};
+    uint64_t scene_triangles;
+    double setup_start = time_now_ms();
+    if (!setup_case(c, &raster_scene, &scene_triangles)) {
+        fprintf(stderr, "Error creating scene: %s\n", c->name);
+        return false;
+    }
+    double setup_ms = time_now_ms() - setup_start;
+
+    for (int i = 0; i < options->warmup; i++) {
+        render_case(c, &raster_scene, pool);
+    }
+
+    double* times = malloc(sizeof(double) * options->frames);
+    if (!times) {
+        raster_scene_free(&raster_scene);
+        texture_free(&bench_texture);
+        return false;
+    }
+    raster_reset_stats();
+    raytracer_reset_stats();
+    double total_ms = 0.0;
+    for (int i = 0; i < options->frames; i++) {
+        double start = time_now_ms();
+        render_case(c, &raster_scene, pool);
+        times[i] = time_now_ms() - start;
+        total_ms += times[i];
+    }
+    raster_stats_t raster_stats = raster_get_stats();
+    uint64_t rays = raytracer_ray_count();
+    qsort(times, options->frames, sizeof(double), compare_double);
+
+    double seconds = total_ms / 1000.0;
+    uint64_t pixels = c->kind != BENCH_RAYTRACE
+        ? raster_stats.pixels
+        : (uint64_t)window_width * window_height * options->frames;
+    uint64_t triangles = c->kind != BENCH_RAYTRACE ? raster_stats.triangles : 0;
+
+    fprintf(out, "%s    {\n", first ? "" : ",\n");
+    fprintf(out, "      \"name\": \"%s\",\n", c->name);
+    fprintf(out, "      \"kind\": \"%s\",\n", c->kind != BENCH_RAYTRACE ? "raster" : "raytrace");
+    fprintf(out, "      \"scene_triangles\": %llu,\n", (unsigned long long)scene_triangles);
+    fprintf(out, "      \"scene_spheres\": %d,\n", c->kind == BENCH_RAYTRACE ? scene_spheres.count : 0);
+    fprintf(out, "      \"setup_ms\": %.3f,\n", setup_ms);
+    fprintf(out, "      \"frames\": %d,\n", options->frames);
+    fprintf(out, "      \"frame_ms\": { \"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+            times[0], total_ms / options->frames,
+            percentile(times, options->frames, 50), percentile(times, options->frames, 90),
+            percentile(times, options->frames, 99), times[options->frames - 1]);
+    fprintf(out, "      \"rays_per_sec\": %.0f,\n", seconds > 0 ? rays / seconds : 0.0);
+    fprintf(out, "      \"triangles_per_sec\": %.0f,\n", seconds > 0 ? triangles / seconds : 0.0);
+    fprintf(out, "      \"pixels_per_sec\": %.0f\n", seconds > 0 ? pixels / seconds : 0.0);
+    fprintf(out, "    }");
+    fflush(out);
+
+    free(times);
+    raster_scene_free(&raster_scene);
+    texture_free(&bench_texture);
+    return true;
+}
+
+static bool parse_options(int argc, char* argv[], bench_options_t* options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) return false;
+        if (strcmp(arg, "--frames") == 0) {
+            options->frames = atoi(value);
+        } else if (strcmp(arg, "--warmup") == 0) {
+            options->warmup = atoi(value);
+        } else if (strcmp(arg, "--threads") == 0) {
+            options->threads = atoi(value);
+        } else if (strcmp(arg, "--filter") == 0) {
+            options->filter = value;
+        } else if (strcmp(arg, "--output") == 0) {
+            options->output = value;
+        } else if (strcmp(arg, "--size") == 0) {
+            if (sscanf(value, "%dx%d", &window_width, &window_height) != 2) return false;
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return options->frames > 0 && options->warmup >= 0 && window_width > 0 && window_height > 0;
+}
+
+int main(int argc, char* argv[]) {
+    bench_options_t options = { .frames = 10, .warmup = 1, .threads = 0, .filter = NULL, .output = NULL };
+    if (!parse_options(argc, argv, &options)) {
+        fprintf(stderr,
+            "Usage: %s [--frames N] [--warmup N] [--size WxH] [--threads N] [--filter TEXT] [--output PATH]\n",
+            argv[0]);
+        return 1;
+    }
+    if (!create_color_buffer()) {
+        fprintf(stderr, "Error allocating color buffer.\n");
+        return 1;
+    }
+    FILE* out = options.output ? fopen(options.output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Error opening output: %s\n", options.output);
+        destroy_color_buffer();
+        return 1;
+    }
+    thread_pool_t* pool = thread_pool_create(options.threads);
+    set_raster_thread_pool(pool);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n  \"threads\": %d,\n", window_width, window_height, thread_pool_size(pool));
+    fprintf(out, "  \"benchmarks\": [\n");
+    bool ok = true, first = true;
+    for (size_t i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]) && ok; i++) {
+        if (options.filter && !strstr(bench_cases[i].name, options.filter)) continue;
+        ok = run_case(out, &bench_cases[i], &options, pool, first);
+        first = false;
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    raytrace_scene_free();
+    thread_pool_destroy(pool);
+    if (out != stdout) fclose(out);
+    destroy_color_buffer();
+    return ok ? 0 : 1;
+}
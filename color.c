@@ -0,0 +1,20 @@
+#include "color.h"
+
+void color_pack_span(const color_t* src, uint32_t* dst, int count) {
+    int i = 0;
+#ifdef COLOR_SSE2
+    for (; i + 4 <= count; i += 4) {
+        __m128i p0 = color_quantize_sse2(_mm_loadu_ps(&src[i + 0].r));
+        __m128i p1 = color_quantize_sse2(_mm_loadu_ps(&src[i + 1].r));
+        __m128i p2 = color_quantize_sse2(_mm_loadu_ps(&src[i + 2].r));
+        __m128i p3 = color_quantize_sse2(_mm_loadu_ps(&src[i + 3].r));
+        // 32位 -> 16位 -> 8位饱和打包，得到4个ARGB8888像素
+        __m128i lo = _mm_packs_epi32(p0, p1);
+        __m128i hi = _mm_packs_epi32(p2, p3);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = color_pack(src[i]);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COLOR_SSE2 1
+#endif
+
+// 线性浮点颜色，分量范围不受限制（HDR），只在打包为ARGB8888时截断到[0, 1]
+// 16字节正好是一个SSE寄存器
+typedef struct {
+    float r, g, b, a;
+} color_t;
+
+static inline color_t color_from_argb(uint32_t argb) {
+    const float k = 1.0f / 255.0f;
+    return (color_t){
+        ((argb >> 16) & 0xFF) * k,
+        ((argb >> 8) & 0xFF) * k,
+        (argb & 0xFF) * k,
+        ((argb >> 24) & 0xFF) * k
+    };
+}
+
+// 只缩放RGB，alpha不变
+static inline color_t color_scale(color_t c, float k) {
+    return (color_t){c.r * k, c.g * k, c.b * k, c.a};
+}
+
+// acc + c * k，只作用于RGB
+static inline color_t color_add_scaled(color_t acc, color_t c, float k) {
+    return (color_t){acc.r + c.r * k, acc.g + c.g * k, acc.b + c.b * k, acc.a};
+}
+
+#ifdef COLOR_SSE2
+// 截断到[0, 1]后四舍五入为0~255的整数，并按ARGB8888的内存顺序（B, G, R, A）排列
+static inline __m128i color_quantize_sse2(__m128 c) {
+    c = _mm_min_ps(_mm_max_ps(c, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    c = _mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+    c = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 1, 2));
+    return _mm_cvttps_epi32(c);
+}
+#endif
+
+// 将一个颜色打包为ARGB8888，与color_pack_span的结果逐位一致
+static inline uint32_t color_pack(color_t c) {
+#ifdef COLOR_SSE2
+    __m128i q = color_quantize_sse2(_mm_loadu_ps(&c.r));
+    q = _mm_packs_epi32(q, q);
+    return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(q, q));
+#else
+    float v[4] = {c.b, c.g, c.r, c.a};
+    uint32_t out = 0;
+    for (int i = 0; i < 4; i++) {
+        float x = v[i] > 0.0f ? v[i] : 0.0f;
+        x = x < 1.0f ? x : 1.0f;
+        out |= (uint32_t)(int)(x * 255.0f + 0.5f) << (i * 8);
+    }
+    return out;
+#endif
+}
+
+// 色调映射并打包count个像素（截断到[0, 1]），SSE2下每次处理4个像素
+void color_pack_span(const color_t* src, uint32_t* dst, int count);
+
+#endif // COLOR_H
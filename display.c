@@ -1,12 +1,33 @@
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 #include "display.h"
 
-SDL_Window* window = NULL;
-SDL_Renderer* renderer = NULL;
 uint32_t* color_buffer = NULL;
-SDL_Texture* color_buffer_texture = NULL;
 int window_width = 600;
 int window_height = 600;
 
+bool create_color_buffer(void) {
+    size_t bytes = sizeof(uint32_t) * (size_t)window_width * window_height;
+    bytes = (bytes + 63) / 64 * 64;
+    color_buffer = aligned_alloc(64, bytes);
+    return color_buffer != NULL;
+}
+
+void destroy_color_buffer(void) {
+    free(color_buffer);
+    color_buffer = NULL;
+}
+
+#ifndef TINY_RENDERER_NO_SDL
+SDL_Window* window = NULL;
+SDL_Renderer* renderer = NULL;
+SDL_Texture* color_buffer_texture = NULL;
+
 bool initialize_window(void) {
     if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
         fprintf(stderr, "Error initializing SDL.\n");
@@ -36,6 +57,7 @@ bool initialize_window(void) {
 
     return true;
 }
+#endif
 
 void draw_grid(void) {
     for (int y = 0; y < window_height; y += 10) {
@@ -53,16 +75,72 @@ void draw_pixel(int x, int y, uint32_t color) {
     }
 }
 
+// 与逐个draw_pixel(x + i, y + j)的结果相同
 void draw_rect(int x, int y, int width, int height, uint32_t color) {
-    for (int i = 0; i < width; i++) {
-        for (int j = 0; j < height; j++) {
-            int current_x = x + i;
-            int current_y = y + j;
-            draw_pixel(current_x, current_y, color);
+    int sx = window_width / 2 + x;
+    for (int j = 0; j < height; j++) {
+        draw_span(window_height / 2 - (y + j), sx, sx + width - 1, color);
+    }
+}
+
+void span_fill(uint32_t* row, int count, uint32_t color) {
+    int i = 0;
+#if defined(__AVX__)
+    __m256 c8 = _mm256_castsi256_ps(_mm256_set1_epi32((int)color));
+    for (; i + 8 <= count; i += 8) _mm256_storeu_ps((float*)(row + i), c8);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128i c4 = _mm_set1_epi32((int)color);
+    for (; i + 4 <= count; i += 4) _mm_storeu_si128((__m128i*)(row + i), c4);
+#endif
+    for (; i < count; i++) row[i] = color;
+}
+
+int span_fill_depth(uint32_t* row, float* depth_row, int count, uint32_t color,
+                    float z, float dzdx, bool depth_test) {
+    int written = 0;
+    int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128 lane_z = _mm_set_ps(dzdx * 3, dzdx * 2, dzdx, 0.0f);
+    __m128i c4 = _mm_set1_epi32((int)color);
+    for (; i + 4 <= count; i += 4) {
+        __m128 zv = _mm_add_ps(_mm_set1_ps(z + dzdx * i), lane_z);
+        if (!depth_test) {
+            _mm_storeu_ps(depth_row + i, zv);
+            _mm_storeu_si128((__m128i*)(row + i), c4);
+            written += 4;
+            continue;
         }
+        __m128 d = _mm_loadu_ps(depth_row + i);
+        __m128 m = _mm_cmplt_ps(d, zv);
+        int bits = _mm_movemask_ps(m);
+        if (!bits) continue;
+        _mm_storeu_ps(depth_row + i, _mm_or_ps(_mm_and_ps(m, zv), _mm_andnot_ps(m, d)));
+        __m128i mi = _mm_castps_si128(m);
+        __m128i old = _mm_loadu_si128((__m128i*)(row + i));
+        _mm_storeu_si128((__m128i*)(row + i), _mm_or_si128(_mm_and_si128(mi, c4), _mm_andnot_si128(mi, old)));
+        written += (bits & 1) + (bits >> 1 & 1) + (bits >> 2 & 1) + (bits >> 3 & 1);
+    }
+#endif
+    for (; i < count; i++) {
+        float zi = (z + dzdx * (i - i % 4)) + dzdx * (i % 4);
+        if (depth_test && !(depth_row[i] < zi)) continue;
+        depth_row[i] = zi;
+        row[i] = color;
+        written++;
     }
+    return written;
 }
 
+void draw_span(int y, int x0, int x1, uint32_t color) {
+    if (y < 0 || y >= window_height) return;
+    if (x0 < 0) x0 = 0;
+    if (x1 > window_width - 1) x1 = window_width - 1;
+    if (x0 > x1) return;
+    span_fill(color_buffer + (size_t)window_width * y + x0, x1 - x0 + 1, color);
+}
+
+#ifndef TINY_RENDERER_NO_SDL
 void render_color_buffer(void) {
     SDL_UpdateTexture(
         color_buffer_texture,
@@ -72,18 +150,18 @@ void render_color_buffer(void) {
     );
     SDL_RenderCopy(renderer, color_buffer_texture, NULL, NULL);
 }
+#endif
 
 void clear_color_buffer(uint32_t color) {
-    for (int y = 0; y < window_height; y++) {
-        for (int x = 0; x < window_width; x++) {
-            color_buffer[(window_width * y) + x] = color;
-        }
-    }
+    // 各行首尾相接，整个缓冲区是一个像素段
+    span_fill(color_buffer, window_width * window_height, color);
 }
 
+#ifndef TINY_RENDERER_NO_SDL
 void destroy_window(void) {
-    free(color_buffer);
+    destroy_color_buffer();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
+#endif
@@ -3,7 +3,10 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+// 定义TINY_RENDERER_NO_SDL时只保留颜色缓冲区相关接口，用于无窗口的离屏渲染
+#ifndef TINY_RENDERER_NO_SDL
 #include <SDL2/SDL.h>
+#endif
 
 #define COLOR_RED    0xFFFF0000
 #define COLOR_GREEN  0xFF00FF00
@@ -12,19 +15,37 @@
 #define COLOR_PURPLE 0xFFFF00FF
 #define COLOR_CYAN   0xFF00FFFF
 
-extern SDL_Window* window;
-extern SDL_Renderer* renderer;
 extern uint32_t* color_buffer;
-extern SDL_Texture* color_buffer_texture;
 extern int window_width;
 extern int window_height;
 
-bool initialize_window(void); 
+// 按window_width x window_height分配颜色缓冲区（64字节对齐），不依赖SDL
+bool create_color_buffer(void);
+void destroy_color_buffer(void);
+
 void draw_grid(void);
 void draw_pixel(int x, int y, uint32_t color);
 void draw_rect(int x, int y, int width, int height, uint32_t color);
-void render_color_buffer(void); 
 void clear_color_buffer(uint32_t color);
+
+// 像素段：从row开始连续写入count个像素，调用者保证整段在缓冲区内，支持时使用SSE2/AVX宽向量存储
+void span_fill(uint32_t* row, int count, uint32_t color);
+// 带深度测试的像素段：depth_row与row一一对应，深度缓冲区存1/z（大者更近）
+// 第i个像素的深度按4个一组计算：(z + dzdx * (i - i % 4)) + dzdx * (i % 4)，与光栅化的块内顺序相同
+// 比已有深度更近的像素写入颜色和深度，depth_test为false时不比较直接写入；返回写入的像素数
+int span_fill_depth(uint32_t* row, float* depth_row, int count, uint32_t color,
+                    float z, float dzdx, bool depth_test);
+// 屏幕坐标（原点在左上角，y向下）第y行[x0, x1]中在颜色缓冲区内的部分，裁剪一次后整段写入
+void draw_span(int y, int x0, int x1, uint32_t color);
+
+#ifndef TINY_RENDERER_NO_SDL
+extern SDL_Window* window;
+extern SDL_Renderer* renderer;
+extern SDL_Texture* color_buffer_texture;
+
+bool initialize_window(void); 
+void render_color_buffer(void); 
 void destroy_window(void);
+#endif
 
 #endif
@@ -0,0 +1,77 @@
+#include "geometry.h"
+#include <stdlib.h>
+#include "simd.h"
+
+void model_compute_bounds(model_t* model) {
+    if (model->vertex_count <= 0) {
+        model->bounds_center = (vec3_t){0, 0, 0};
+        model->bounds_radius = 0.0f;
+        return;
+    }
+    vec3_t lo = model->vertexes[0], hi = model->vertexes[0];
+    for (int i = 1; i < model->vertex_count; i++) {
+        vec3_t v = model->vertexes[i];
+        if (v.x < lo.x) lo.x = v.x;
+        if (v.y < lo.y) lo.y = v.y;
+        if (v.z < lo.z) lo.z = v.z;
+        if (v.x > hi.x) hi.x = v.x;
+        if (v.y > hi.y) hi.y = v.y;
+        if (v.z > hi.z) hi.z = v.z;
+    }
+    vec3_t center = vec3_scale(vec3_add(lo, hi), 0.5f);
+    float radius_sq = 0.0f;
+    for (int i = 0; i < model->vertex_count; i++) {
+        vec3_t d = vec3_sub(model->vertexes[i], center);
+        float len_sq = vec3_dot(d, d);
+        if (len_sq > radius_sq) radius_sq = len_sq;
+    }
+    model->bounds_center = center;
+    model->bounds_radius = sqrtf(radius_sq);
+}
+
+model_t model_make(vec3_t* vertexes, int vertex_count, triangle_t* triangles, int triangle_count) {
+    model_t model = {
+        .vertexes = vertexes,
+        .vertex_count = vertex_count,
+        .triangles = triangles,
+        .triangle_count = triangle_count
+    };
+    model_compute_bounds(&model);
+    return model;
+}
+
+bool model_build_soa(model_t* model) {
+    model_free_soa(model);
+    if (model->vertex_count <= 0) return true;
+    int padded = (model->vertex_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    int arrays = model->normals ? 6 : 3;
+    float* data = aligned_alloc(SIMD_ALIGN, sizeof(float) * arrays * padded);
+    if (!data) return false;
+    model->soa.x = data;
+    model->soa.y = data + padded;
+    model->soa.z = data + padded * 2;
+    model->soa.padded_count = padded;
+    for (int i = 0; i < padded; i++) {
+        vec3_t v = i < model->vertex_count ? model->vertexes[i] : (vec3_t){0, 0, 0};
+        model->soa.x[i] = v.x;
+        model->soa.y[i] = v.y;
+        model->soa.z[i] = v.z;
+    }
+    if (model->normals) {
+        model->soa.nx = data + padded * 3;
+        model->soa.ny = data + padded * 4;
+        model->soa.nz = data + padded * 5;
+        for (int i = 0; i < padded; i++) {
+            vec3_t n = i < model->vertex_count ? model->normals[i] : (vec3_t){0, 0, 0};
+            model->soa.nx[i] = n.x;
+            model->soa.ny[i] = n.y;
+            model->soa.nz[i] = n.z;
+        }
+    }
+    return true;
+}
+
+void model_free_soa(model_t* model) {
+    free(model->soa.x);
+    model->soa = (vertex_soa_t){0};
+}
@@ -2,8 +2,9 @@
 #define GEOMETRY_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "vector.h"
-#include "matrix.h"
+#include "mat4.h"
 
 typedef struct {
     int v0, v1, v2; // 顶点索引
@@ -26,6 +27,19 @@ typedef struct {
     uint32_t color;
 } triangle3_t;
 
+// 顶点坐标的SoA副本，供批量变换使用
+// x、y、z三个数组放在同一块按SIMD_ALIGN对齐的内存中，长度补齐到SIMD宽度的整数倍（补齐部分为0）
+// 模型有法向量时nx、ny、nz为法向量的副本（同一块内存），否则为NULL
+typedef struct {
+    float* x;
+    float* y;
+    float* z;
+    float* nx;
+    float* ny;
+    float* nz;
+    int padded_count;
+} vertex_soa_t;
+
 // 3D模型结构体
 typedef struct {
     vec3_t* vertexes;        // 顶点数组
@@ -34,22 +48,26 @@ typedef struct {
     int triangle_count;      // 三角形数量
     vec3_t bounds_center;    // 包围球中心
     float bounds_radius;     // 包围球半径
+    vertex_soa_t soa;        // 顶点的SoA副本，未生成时x为NULL
+    // 可选的顶点属性，与vertexes一一对应，NULL表示没有
+    vec3_t* normals;         // 法向量（模型空间）
+    vec2_t* uvs;             // 纹理坐标
+    uint32_t* colors;        // 顶点颜色（ARGB）
 } model_t;
 
 // 实例结构体
 typedef struct {
     model_t* model;          // 指向模型
     vec3_t position;         // 位置
-    // 4x4变换矩阵，行优先，长度16
-    matrix_t orientation;    // 方向（旋转/变换矩阵）
+    mat4_t orientation;      // 方向（旋转/变换矩阵）
     float scale;             // 缩放
 } instance_t;
 
 // 相机结构体
 typedef struct {
     vec3_t position;         // 相机位置
-    matrix_t orientation;    // 相机方向（4x4矩阵）
-    // 裁剪平面数组
+    mat4_t orientation;      // 相机方向
+    // 裁剪平面数组，第0个为近平面
     struct plane_t* clipping_planes;
     int clipping_plane_count;
 } camera_t;
@@ -60,6 +78,15 @@ typedef struct plane_t {
     float distance;          // 距离
 } plane_t;
 
+// 由顶点计算模型的包围球：中心取顶点包围盒的中心，半径取到最远顶点的距离
+void model_compute_bounds(model_t* model);
+
+// 用已有的顶点和三角形数组（不复制）创建模型，并自动计算包围球
+model_t model_make(vec3_t* vertexes, int vertex_count, triangle_t* triangles, int triangle_count);
 
+// 由vertexes（和normals）生成SoA副本（原有副本会被释放），顶点或法向量修改后需重新生成；内存不足时返回false
+bool model_build_soa(model_t* model);
+// 释放SoA副本，不影响vertexes和triangles
+void model_free_soa(model_t* model);
 
 #endif // GEOMETRY_H 
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "image_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool image_format_from_path(const char* path, image_format_t* format) {
+    const char* ext = strrchr(path, '.');
+    if (!ext) return false;
+    if (strcmp(ext, ".ppm") == 0) { *format = IMAGE_FORMAT_PPM; return true; }
+    if (strcmp(ext, ".png") == 0) { *format = IMAGE_FORMAT_PNG; return true; }
+    if (strcmp(ext, ".raw") == 0) { *format = IMAGE_FORMAT_RAW; return true; }
+    return false;
+}
+
+// 将一行ARGB像素转换为RGB字节
+static void argb_row_to_rgb(const uint32_t* src, uint8_t* dst, int width) {
+    for (int x = 0; x < width; x++) {
+        uint32_t c = src[x];
+        dst[x * 3 + 0] = (uint8_t)(c >> 16);
+        dst[x * 3 + 1] = (uint8_t)(c >> 8);
+        dst[x * 3 + 2] = (uint8_t)c;
+    }
+}
+
+bool image_write_ppm(const char* path, const uint32_t* pixels, int width, int height) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    uint8_t* row = malloc((size_t)width * 3);
+    bool ok = row != NULL && fprintf(f, "P6\n%d %d\n255\n", width, height) > 0;
+    for (int y = 0; ok && y < height; y++) {
+        argb_row_to_rgb(pixels + (size_t)width * y, row, width);
+        ok = fwrite(row, 3, width, f) == (size_t)width;
+    }
+    free(row);
+    return fclose(f) == 0 && ok;
+}
+
+bool image_write_raw(const char* path, const uint32_t* pixels, int width, int height) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    size_t count = (size_t)width * height;
+    bool ok = fwrite(pixels, sizeof(uint32_t), count, f) == count;
+    return fclose(f) == 0 && ok;
+}
+
+#pragma region PNG
+
+static uint32_t crc_table[256];
+static bool crc_table_ready = false;
+
+static void init_crc_table(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+    crc_table_ready = true;
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void put_u32_be(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// IDAT数据流写入器：把zlib流切分为不超过65535字节的存储块，同时累计CRC和Adler-32
+typedef struct {
+    FILE* file;
+    uint32_t crc;
+    uint32_t adler_a, adler_b;
+    size_t remaining;       // 剩余的未压缩数据字节数
+    size_t block_left;      // 当前存储块剩余字节数
+    bool ok;
+} png_stream_t;
+
+static void png_stream_raw(png_stream_t* s, const uint8_t* data, size_t len) {
+    s->crc = crc_update(s->crc, data, len);
+    if (fwrite(data, 1, len, s->file) != len) s->ok = false;
+}
+
+static void png_stream_data(png_stream_t* s, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        if (s->block_left == 0) {
+            size_t block = s->remaining < 65535 ? s->remaining : 65535;
+            uint8_t header[5] = {
+                (uint8_t)(block == s->remaining ? 1 : 0),
+                (uint8_t)block, (uint8_t)(block >> 8),
+                (uint8_t)~block, (uint8_t)(~block >> 8)
+            };
+            png_stream_raw(s, header, sizeof(header));
+            s->block_left = block;
+        }
+        size_t n = len < s->block_left ? len : s->block_left;
+        // 每5552字节取一次模，保证32位累加不溢出
+        for (size_t i = 0; i < n; ) {
+            size_t end = i + 5552 < n ? i + 5552 : n;
+            for (; i < end; i++) {
+                s->adler_a += data[i];
+                s->adler_b += s->adler_a;
+            }
+            s->adler_a %= 65521;
+            s->adler_b %= 65521;
+        }
+        png_stream_raw(s, data, n);
+        s->block_left -= n;
+        s->remaining -= n;
+        data += n;
+        len -= n;
+    }
+}
+
+static bool png_write_chunk(FILE* f, const char* type, const uint8_t* data, uint32_t len) {
+    uint8_t head[8];
+    put_u32_be(head, len);
+    memcpy(head + 4, type, 4);
+    uint32_t crc = crc_update(0xFFFFFFFFu, head + 4, 4);
+    crc = crc_update(crc, data, len);
+    uint8_t tail[4];
+    put_u32_be(tail, crc ^ 0xFFFFFFFFu);
+    return fwrite(head, 1, 8, f) == 8 &&
+           (len == 0 || fwrite(data, 1, len, f) == len) &&
+           fwrite(tail, 1, 4, f) == 4;
+}
+
+bool image_write_png(const char* path, const uint32_t* pixels, int width, int height) {
+    if (!crc_table_ready) init_crc_table();
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    uint8_t ihdr[13];
+    put_u32_be(ihdr, (uint32_t)width);
+    put_u32_be(ihdr + 4, (uint32_t)height);
+    ihdr[8] = 8;    // 位深
+    ihdr[9] = 2;    // RGB
+    ihdr[10] = 0;   // deflate
+    ihdr[11] = 0;   // 标准过滤
+    ihdr[12] = 0;   // 不隔行
+    bool ok = fwrite(signature, 1, 8, f) == 8 && png_write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+
+    // 每行前有一个过滤类型字节（0，不过滤）
+    size_t row_bytes = (size_t)width * 3 + 1;
+    size_t data_len = row_bytes * height;
+    size_t block_count = (data_len + 65534) / 65535;
+    uint32_t idat_len = (uint32_t)(2 + block_count * 5 + data_len + 4);
+
+    uint8_t* row = malloc(row_bytes);
+    ok = ok && row != NULL;
+    if (ok) {
+        uint8_t head[8];
+        put_u32_be(head, idat_len);
+        memcpy(head + 4, "IDAT", 4);
+        ok = fwrite(head, 1, 8, f) == 8;
+
+        png_stream_t s = {f, crc_update(0xFFFFFFFFu, head + 4, 4), 1, 0, data_len, 0, ok};
+        static const uint8_t zlib_header[2] = {0x78, 0x01};
+        png_stream_raw(&s, zlib_header, 2);
+        row[0] = 0;
+        for (int y = 0; y < height && s.ok; y++) {
+            argb_row_to_rgb(pixels + (size_t)width * y, row + 1, width);
+            png_stream_data(&s, row, row_bytes);
+        }
+        uint8_t adler[4];
+        put_u32_be(adler, (s.adler_b << 16) | s.adler_a);
+        png_stream_raw(&s, adler, 4);
+        uint8_t crc[4];
+        put_u32_be(crc, s.crc ^ 0xFFFFFFFFu);
+        ok = s.ok && fwrite(crc, 1, 4, f) == 4 && png_write_chunk(f, "IEND", NULL, 0);
+    }
+    free(row);
+    return fclose(f) == 0 && ok;
+}
+
+#pragma endregion
+
+bool image_write(const char* path, image_format_t format, const uint32_t* pixels, int width, int height) {
+    switch (format) {
+        case IMAGE_FORMAT_PPM: return image_write_ppm(path, pixels, width, height);
+        case IMAGE_FORMAT_PNG: return image_write_png(path, pixels, width, height);
+        case IMAGE_FORMAT_RAW: return image_write_raw(path, pixels, width, height);
+    }
+    return false;
+}
@@ -0,0 +1,30 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 将ARGB8888像素直接写成图片文件，不依赖SDL和第三方库
+// raw格式直接把缓冲区写入文件，无需拷贝；PPM/PNG逐行转换为RGB后写出
+
+typedef enum {
+    IMAGE_FORMAT_PPM,
+    IMAGE_FORMAT_PNG,
+    IMAGE_FORMAT_RAW
+} image_format_t;
+
+// 根据文件扩展名判断格式（.ppm/.png/.raw），无法识别时返回false
+bool image_format_from_path(const char* path, image_format_t* format);
+
+// 二进制PPM（P6），丢弃alpha通道
+bool image_write_ppm(const char* path, const uint32_t* pixels, int width, int height);
+
+// 未压缩的PNG（deflate存储块），RGB 8位
+bool image_write_png(const char* path, const uint32_t* pixels, int width, int height);
+
+// 原始ARGB8888像素，按机器字节序，无文件头
+bool image_write_raw(const char* path, const uint32_t* pixels, int width, int height);
+
+bool image_write(const char* path, image_format_t format, const uint32_t* pixels, int width, int height);
+
+#endif // IMAGE_IO_H
@@ -0,0 +1,168 @@
+#include "lighting.h"
+#include <math.h>
+#include "simd.h"
+
+// 指数不超过此值时用连乘计算镜面项
+#define LIGHTING_MAX_POWER 65536
+
+lighting_specular_t lighting_specular_make(float exponent) {
+    lighting_specular_t specular = {exponent, 0, 0.0f};
+    if (exponent > 0.0f) {
+        if (exponent <= LIGHTING_MAX_POWER && exponent == (float)(int)exponent) {
+            specular.power = (int)exponent;
+        }
+        specular.cutoff = powf(1e-30f, 1.0f / exponent);
+    }
+    return specular;
+}
+
+void lighting_prepare(lighting_t* lighting, const light_t* lights, int light_count,
+                      const mat4_t* view, float specular) {
+    lighting->ambient = 0.0f;
+    lighting->count = 0;
+    for (int i = 0; i < light_count; i++) {
+        light_t light = lights[i];
+        if (light.ltype == LIGHT_AMBIENT) {
+            lighting->ambient += light.intensity;
+            continue;
+        }
+        if (lighting->count == LIGHTING_MAX_LIGHTS) continue;
+        int k = lighting->count++;
+        lighting->point[k] = light.ltype == LIGHT_POINT;
+        lighting->intensity[k] = light.intensity;
+        if (light.ltype == LIGHT_POINT) {
+            lighting->position[k] = mat4_transform_point(view, light.position);
+        } else {
+            // 方向只受旋转影响
+            mat3_t rotation = mat3_from_mat4(view);
+            lighting->position[k] = mat3_mul_vec3(&rotation, light.position);
+        }
+    }
+    lighting->specular = lighting_specular_make(specular);
+}
+
+// c^exponent，c在(cutoff, 1]内；整数指数按二进制位连乘，最大的中间值不超过c^exponent，不会产生非规格化数
+static float specular_power(const lighting_specular_t* specular, float c) {
+    int e = specular->power;
+    if (e == 0) return powf(c, specular->exponent);
+    float result = 1.0f;
+    for (;;) {
+        if (e & 1) result *= c;
+        e >>= 1;
+        if (!e) break;
+        c *= c;
+    }
+    return result;
+}
+
+float lighting_light_term(vec3_t normal, float length_n, vec3_t l, vec3_t view, float length_v,
+                          float intensity, const lighting_specular_t* specular) {
+    // 没有法向量时n·l为0、r = -l，镜面项没有意义
+    if (length_n == 0.0f) return 0.0f;
+    float term = 0.0f;
+
+    // 漫反射
+    float n_dot_l = normal.x * l.x + normal.y * l.y + normal.z * l.z;
+    if (n_dot_l > 0) {
+        float length_l = sqrtf(l.x * l.x + l.y * l.y + l.z * l.z);
+        term += intensity * n_dot_l / (length_n * length_l);
+    }
+
+    // 镜面反射
+    if (specular->exponent != -1) {
+        float k = 2 * n_dot_l;
+        vec3_t r = {normal.x * k - l.x, normal.y * k - l.y, normal.z * k - l.z};
+        float r_dot_v = r.x * view.x + r.y * view.y + r.z * view.z;
+        float c = r_dot_v / (sqrtf(r.x * r.x + r.y * r.y + r.z * r.z) * length_v);
+        if (c > specular->cutoff) term += intensity * specular_power(specular, c);
+    }
+    return term;
+}
+
+float lighting_intensity(const lighting_t* lighting, vec3_t point, vec3_t normal) {
+    float intensity = lighting->ambient;
+    float length_n = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+    vec3_t view = {-point.x, -point.y, -point.z};
+    float length_v = sqrtf(view.x * view.x + view.y * view.y + view.z * view.z);
+    for (int i = 0; i < lighting->count; i++) {
+        vec3_t l = lighting->position[i];
+        if (lighting->point[i]) l = (vec3_t){l.x - point.x, l.y - point.y, l.z - point.z};
+        intensity += lighting_light_term(normal, length_n, l, view, length_v, lighting->intensity[i], &lighting->specular);
+    }
+    return intensity;
+}
+
+static inline simd_float simd_dot3(simd_float ax, simd_float ay, simd_float az,
+                                   simd_float bx, simd_float by, simd_float bz) {
+    return simd_add(simd_add(simd_mul(ax, bx), simd_mul(ay, by)), simd_mul(az, bz));
+}
+
+// 与lighting_intensity的运算顺序相同，结果逐位一致
+void lighting_intensity_batch(const lighting_t* lighting,
+                              const float* x, const float* y, const float* z,
+                              const float* nx, const float* ny, const float* nz,
+                              float* out, int count) {
+    const lighting_specular_t* specular = &lighting->specular;
+    simd_float zero = simd_set1(0.0f), two = simd_set1(2.0f);
+    simd_float cutoff = simd_set1(specular->cutoff);
+    bool has_specular = specular->exponent != -1;
+    _Alignas(SIMD_ALIGN) float lanes[SIMD_WIDTH];
+    for (int i = 0; i < count; i += SIMD_WIDTH) {
+        simd_float px = simd_load(x + i), py = simd_load(y + i), pz = simd_load(z + i);
+        simd_float qx = simd_load(nx + i), qy = simd_load(ny + i), qz = simd_load(nz + i);
+        simd_float vx = simd_sub(zero, px), vy = simd_sub(zero, py), vz = simd_sub(zero, pz);
+        simd_float length_n = simd_sqrt(simd_dot3(qx, qy, qz, qx, qy, qz));
+        simd_float length_v = simd_sqrt(simd_dot3(vx, vy, vz, vx, vy, vz));
+        // 法向量长度为0的通道只有环境光（n·l为0，没有漫反射）
+        simd_mask has_normal = simd_cmplt(zero, length_n);
+        simd_float sum = simd_set1(lighting->ambient);
+        for (int k = 0; k < lighting->count; k++) {
+            vec3_t p = lighting->position[k];
+            simd_float lx = simd_set1(p.x), ly = simd_set1(p.y), lz = simd_set1(p.z);
+            if (lighting->point[k]) {
+                lx = simd_sub(lx, px);
+                ly = simd_sub(ly, py);
+                lz = simd_sub(lz, pz);
+            }
+            simd_float intensity = simd_set1(lighting->intensity[k]);
+
+            // 漫反射：n·l <= 0的通道结果无意义（可能是NaN），由select丢弃
+            simd_float n_dot_l = simd_dot3(qx, qy, qz, lx, ly, lz);
+            simd_float length_l = simd_sqrt(simd_dot3(lx, ly, lz, lx, ly, lz));
+            simd_float diffuse = simd_div(simd_mul(intensity, n_dot_l), simd_mul(length_n, length_l));
+            simd_float term = simd_select(simd_cmplt(zero, n_dot_l), diffuse, zero);
+
+            // 镜面反射
+            if (has_specular) {
+                simd_float k2 = simd_mul(two, n_dot_l);
+                simd_float rx = simd_sub(simd_mul(qx, k2), lx);
+                simd_float ry = simd_sub(simd_mul(qy, k2), ly);
+                simd_float rz = simd_sub(simd_mul(qz, k2), lz);
+                simd_float r_dot_v = simd_dot3(rx, ry, rz, vx, vy, vz);
+                simd_float c = simd_div(r_dot_v, simd_mul(simd_sqrt(simd_dot3(rx, ry, rz, rx, ry, rz)), length_v));
+                simd_mask lit = simd_mask_and(simd_cmplt(cutoff, c), has_normal);
+                if (simd_mask_bits(lit)) {
+                    c = simd_select(lit, c, zero);
+                    simd_float power;
+                    int e = specular->power;
+                    if (e > 0) {
+                        power = simd_set1(1.0f);
+                        for (;;) {
+                            if (e & 1) power = simd_mul(power, c);
+                            e >>= 1;
+                            if (!e) break;
+                            c = simd_mul(c, c);
+                        }
+                    } else {
+                        simd_store(lanes, c);
+                        for (int j = 0; j < SIMD_WIDTH; j++) lanes[j] = powf(lanes[j], specular->exponent);
+                        power = simd_load(lanes);
+                    }
+                    term = simd_add(term, simd_select(lit, simd_mul(intensity, power), zero));
+                }
+            }
+            sum = simd_add(sum, term);
+        }
+        simd_store(out + i, sum);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <stdbool.h>
+#include "vector.h"
+#include "mat4.h"
+
+// 光源模型，光线追踪（compute_lighting）和光栅化共用
+// 光照强度 = 环境光之和 + 各光源的漫反射 intensity * n·l / (|n||l|)
+//          + 镜面反射 intensity * (r·v / (|r||v|))^specular，r = 2n(n·l) - l
+
+// 光源类型
+enum light_type {
+    LIGHT_AMBIENT,
+    LIGHT_POINT,
+    LIGHT_DIRECTIONAL
+};
+
+// 光源结构体：点光源的position为位置，平行光的position为指向光源的方向
+typedef struct {
+    enum light_type ltype;
+    float intensity;
+    vec3_t position;
+} light_t;
+
+#define LIGHTING_MAX_LIGHTS 16
+
+// 镜面指数和由它预先算出的参数，同一指数的多次计算共用
+typedef struct {
+    float exponent;         // 镜面指数，-1表示没有镜面反射
+    int power;              // exponent为正整数时用连乘代替pow，否则为0
+    float cutoff;           // 余弦低于此值时镜面项小于1e-30，直接取0（避免非规格化数）
+} lighting_specular_t;
+
+lighting_specular_t lighting_specular_make(float exponent);
+
+// 一个点光源或平行光的漫反射和镜面反射之和（光线追踪在阴影测试之后、光栅化对每个光源调用）
+// l为从point指向光源的向量（平行光为光源方向），view为从point指向相机的向量，
+// length_n、length_v为normal和view的长度；法向量长度为0时返回0
+float lighting_light_term(vec3_t normal, float length_n, vec3_t l, vec3_t view, float length_v,
+                          float intensity, const lighting_specular_t* specular);
+
+// 变换到相机空间的光源（相机在原点，视线方向v = -point），供光栅化使用，不检测阴影
+typedef struct {
+    float ambient;                              // 环境光强度之和
+    int count;                                  // 点光源和平行光的个数
+    bool point[LIGHTING_MAX_LIGHTS];            // true为点光源，false为平行光
+    float intensity[LIGHTING_MAX_LIGHTS];
+    vec3_t position[LIGHTING_MAX_LIGHTS];       // 相机空间的位置或方向
+    lighting_specular_t specular;
+} lighting_t;
+
+// 由世界空间的光源生成相机空间的光源，view为世界到相机空间的变换，超出LIGHTING_MAX_LIGHTS的光源被忽略
+void lighting_prepare(lighting_t* lighting, const light_t* lights, int light_count,
+                      const mat4_t* view, float specular);
+
+// 相机空间point处的光照强度：环境光加上各光源的lighting_light_term，normal不必归一化（长度为0时只有环境光）
+float lighting_intensity(const lighting_t* lighting, vec3_t point, vec3_t normal);
+
+// 批量计算count个点的光照强度：SoA数组按SIMD_ALIGN对齐，count须是SIMD_WIDTH的整数倍
+void lighting_intensity_batch(const lighting_t* lighting,
+                              const float* x, const float* y, const float* z,
+                              const float* nx, const float* ny, const float* nz,
+                              float* out, int count);
+
+#endif // LIGHTING_H
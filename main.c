@@ -1,32 +1,98 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef TINY_RENDERER_NO_SDL
 #include <SDL2/SDL.h>
+#endif
 #include "display.h"
+#include "image_io.h"
 #include "raytracer.h"
 #include "matrix.h"
 #include "raster.h"
 #include "geometry.h"
+#include "thread_pool.h"
+#include "scenes.h"
+#include "profile.h"
+
+typedef enum {
+    SCENE_RASTER,
+    SCENE_RAYTRACE
+} scene_kind_t;
+
+// 命令行选项
+typedef struct {
+    bool headless;
+    int frames;             // 无窗口模式下渲染的帧数
+    scene_kind_t scene;
+    const char* model;      // 光栅化场景载入的OBJ模型，NULL时使用立方体场景
+    const char* output;     // 输出路径，包含%d时每帧写一个文件（第一个%d替换为帧号），否则只写最后一帧
+    int threads;            // 0表示使用CPU核心数
+    double budget_ms;       // >0时光线追踪使用渐进式预览，每帧的时间预算
+    const char* profile_json;   // 退出时写入最后一帧的性能统计
+    const char* profile_trace;  // 退出时写入最后一帧的Chrome trace
+} options_t;
 
 bool is_running = false;
+thread_pool_t* render_pool = NULL;
+raster_scene_t raster_scene;
+options_t options = {
+#ifdef TINY_RENDERER_NO_SDL
+    .headless = true,
+#else
+    .headless = false,
+#endif
+    .frames = 1,
+    .scene = SCENE_RASTER,
+    .model = NULL,
+    .output = NULL,
+    .threads = 0,
+    .budget_ms = 0.0,
+    .profile_json = NULL,
+    .profile_trace = NULL
+};
 
 void setup(void) {
     // 分配颜色缓冲区内存
-    color_buffer = (uint32_t*) malloc(sizeof(uint32_t) * window_width * window_height);
+    if (!create_color_buffer()) {
+        fprintf(stderr, "Error allocating color buffer.\n");
+        exit(1);
+    }
 
+#ifndef TINY_RENDERER_NO_SDL
     // 创建SDL纹理用于显示颜色缓冲区
-    color_buffer_texture = SDL_CreateTexture(
-        renderer,
-        SDL_PIXELFORMAT_ARGB8888,
-        SDL_TEXTUREACCESS_STREAMING,
-        window_width,
-        window_height
-    );
-
-    // 初始化场景
-    init_scene();
+    if (!options.headless) {
+        color_buffer_texture = SDL_CreateTexture(
+            renderer,
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING,
+            window_width,
+            window_height
+        );
+    }
+#endif
+
+    // 创建渲染线程池（默认线程数取CPU核心数），光线追踪和分块光栅化共用
+    render_pool = thread_pool_create(options.threads);
+    set_raster_thread_pool(render_pool);
+
+    // 光线追踪才需要场景BVH，光栅化时跳过以减少启动开销
+    if (options.scene == SCENE_RAYTRACE) {
+        // 初始化场景
+        init_scene();
+    } else if (options.model) {
+        if (!raster_scene_model_file(&raster_scene, options.model)) {
+            fprintf(stderr, "Error loading model: %s\n", options.model);
+            exit(1);
+        }
+    } else if (!raster_scene_cubes(&raster_scene)) {
+        fprintf(stderr, "Error creating raster scene.\n");
+        exit(1);
+    }
 }
 
+#ifndef TINY_RENDERER_NO_SDL
 void process_input(void) {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
@@ -41,6 +107,7 @@ void process_input(void) {
         }
     }
 }
+#endif
 
 void update(void) {
     // Raytracing不需要更新逻辑
@@ -48,22 +115,12 @@ void update(void) {
 
 void raytracer_test()
 {
-    // 对每个像素进行光线追踪
-    for (int x = -window_width/2; x < window_width/2; x++) {
-        for (int y = -window_height/2; y < window_height/2; y++) {
-            vec3_t direction = canvas_to_viewport(x, y);
-            direction = normalize(direction);
-            direction = matrix_mul_vec3(camera_rotation, direction);
-
-            uint32_t color = trace_ray(camera_position, direction, 1, INFINITY, 3);
-            
-            // 绘制像素
-            draw_pixel(
-                x,
-                y,
-                color
-            );
-        }
+    if (options.budget_ms > 0) {
+        // 渐进式预览，相机和场景不变时逐帧细化
+        raytracer_render_progressive(render_pool, options.budget_ms);
+    } else {
+        // 分块并行光线追踪，结果直接写入颜色缓冲区
+        raytracer_render_frame(render_pool);
     }
 }
 
@@ -159,76 +216,8 @@ void draw_cube()
 
 void clipping_test()
 {
-    vec3_t cube_vertexes[] = {
-        {  1,  1,  1 },
-        { -1,  1,  1 },
-        { -1, -1,  1 },
-        {  1, -1,  1 },
-        {  1,  1, -1 },
-        { -1,  1, -1 },
-        { -1, -1, -1 },
-        {  1, -1, -1 }
-    };
-
-    triangle_t cube_triangles[] = {
-        {0, 1, 2, COLOR_RED},
-        {0, 2, 3, COLOR_RED},
-        {4, 0, 3, COLOR_GREEN},
-        {4, 3, 7, COLOR_GREEN},
-        {5, 4, 7, COLOR_BLUE},
-        {5, 7, 6, COLOR_BLUE},
-        {1, 5, 6, COLOR_YELLOW},
-        {1, 6, 2, COLOR_YELLOW},
-        {4, 5, 1, COLOR_PURPLE},
-        {4, 1, 0, COLOR_PURPLE},
-        {2, 6, 7, COLOR_CYAN},
-        {2, 7, 3, COLOR_CYAN}
-    };
-
-    model_t cube = {
-        .vertexes = cube_vertexes,
-        .vertex_count = 8,
-        .triangles = cube_triangles,
-        .triangle_count = 12,
-        .bounds_center = {0, 0, 0},
-        .bounds_radius = 1.73205f // sqrt(3)
-    };
-
-    instance_t instances[] = {
-        { 
-            .model = &cube, 
-            .position = { -1.5f, 0.0f, 7.0f }, 
-            .orientation = matrix_identity(4),
-            .scale = 0.75
-        },
-        { 
-            .model = &cube, 
-            .position = {  1.25f, 2.5f, 7.5f },
-            .orientation = matrix_make_oy_rotation(195),
-            .scale = 1
-        },
-
-    };
-
-    float s2 = 0.70710678f; // sqrt(2)/2
-    plane_t clipping_planes[] = {
-        { { 0, 0, 1 }, -1 },           // Near
-        { { s2, 0, s2 }, 0 },          // Left
-        { { -s2, 0, s2 }, 0 },         // Right
-        { { 0, -s2, s2 }, 0 },         // Top
-        { { 0, s2, s2 }, 0 }           // Bottom
-    };
-    int clipping_plane_count = 5;
-
-    camera_t camera = {
-        .position = { -3.0f, 1.0f, 2.0f },
-        .orientation = matrix_make_oy_rotation(-30),
-        .clipping_planes = clipping_planes,
-        .clipping_plane_count = 5,
-    };
-
-    set_triangle_outline_enabled(true);
-    render_scene(camera, instances, 2);
+    // 两个立方体的裁剪测试场景（见scenes.c）
+    raster_scene_render(&raster_scene);
 }
 
 
@@ -249,18 +238,165 @@ void raster_test()
     clipping_test();
 }
 
-void render(void) {
+// 将一帧渲染到颜色缓冲区
+void render_frame(void) {
     // 清空颜色缓冲区
     clear_color_buffer(0xFF000000);
-    
-    // raytracer_test();
-    raster_test();
+
+    if (options.scene == SCENE_RAYTRACE) {
+        raytracer_test();
+    } else {
+        raster_test();
+    }
+}
+
+#ifndef TINY_RENDERER_NO_SDL
+void render(void) {
+    PROFILE_FRAME_BEGIN();
+    render_frame();
     // 渲染颜色缓冲区
+    PROFILE_BEGIN(PROFILE_STAGE_PRESENT);
     render_color_buffer();
     SDL_RenderPresent(renderer);
+    PROFILE_END(PROFILE_STAGE_PRESENT);
+    PROFILE_FRAME_END();
+}
+#endif
+
+// 写出最后一帧的性能数据，未启用TINY_RENDERER_PROFILE时给出提示
+static void write_profile(void) {
+    const char* paths[2] = { options.profile_json, options.profile_trace };
+    for (int i = 0; i < 2; i++) {
+        if (!paths[i]) continue;
+        FILE* f = fopen(paths[i], "w");
+        bool ok = f && (i == 0 ? profile_write_json(f) : profile_write_chrome_trace(f));
+        if (f) fclose(f);
+        if (!ok) {
+            fprintf(stderr, "Error writing profile: %s (build with TINY_RENDERER_PROFILE=ON)\n", paths[i]);
+        }
+    }
 }
 
-int main(void) {
+// 无窗口模式：渲染指定帧数，直接从颜色缓冲区写出图片
+int run_headless(void) {
+    image_format_t format = IMAGE_FORMAT_PPM;
+    if (options.output && !image_format_from_path(options.output, &format)) {
+        fprintf(stderr, "Unknown output format: %s (expected .ppm, .png or .raw)\n", options.output);
+        return 1;
+    }
+    // 第一个%d替换为帧号，路径本身不作为格式串，其余的%原样保留
+    const char* frame_field = options.output ? strstr(options.output, "%d") : NULL;
+    bool per_frame = frame_field != NULL;
+
+    for (int frame = 0; frame < options.frames; frame++) {
+        PROFILE_FRAME_BEGIN();
+        update();
+        render_frame();
+
+        if (!options.output || (!per_frame && frame != options.frames - 1)) {
+            PROFILE_FRAME_END();
+            continue;
+        }
+
+        char path[1024];
+        if (per_frame) {
+            snprintf(path, sizeof(path), "%.*s%d%s",
+                     (int)(frame_field - options.output), options.output, frame, frame_field + 2);
+        } else {
+            snprintf(path, sizeof(path), "%s", options.output);
+        }
+        PROFILE_BEGIN(PROFILE_STAGE_PRESENT);
+        bool written = image_write(path, format, color_buffer, window_width, window_height);
+        PROFILE_END(PROFILE_STAGE_PRESENT);
+        PROFILE_FRAME_END();
+        if (!written) {
+            fprintf(stderr, "Error writing image: %s\n", path);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --headless            render without a window\n"
+        "  --frames N            number of frames to render in headless mode (default 1)\n"
+        "  --scene raster|raytrace\n"
+        "  --model PATH          load an OBJ model into the raster scene (cached as PATH.cache)\n"
+        "  --output PATH         write .ppm/.png/.raw; %%d in PATH writes one file per frame\n"
+        "  --size WxH            color buffer size (default 600x600)\n"
+        "  --threads N           render worker threads for ray tracing and rasterization (default: CPU count)\n"
+        "  --budget MS           progressive ray tracing with a per-frame time budget\n"
+        "  --profile-json PATH   write last-frame stage timings and counters on exit\n"
+        "  --profile-trace PATH  write last-frame Chrome trace on exit\n",
+        program);
+}
+
+static bool parse_options(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--headless") == 0) {
+            options.headless = true;
+        } else if (strcmp(arg, "--frames") == 0 && value) {
+            options.frames = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--scene") == 0 && value) {
+            if (strcmp(value, "raster") == 0) {
+                options.scene = SCENE_RASTER;
+            } else if (strcmp(value, "raytrace") == 0) {
+                options.scene = SCENE_RAYTRACE;
+            } else {
+                return false;
+            }
+            i++;
+        } else if (strcmp(arg, "--model") == 0 && value) {
+            options.model = value;
+            i++;
+        } else if (strcmp(arg, "--output") == 0 && value) {
+            options.output = value;
+            i++;
+        } else if (strcmp(arg, "--size") == 0 && value) {
+            if (sscanf(value, "%dx%d", &window_width, &window_height) != 2) return false;
+            i++;
+        } else if (strcmp(arg, "--threads") == 0 && value) {
+            options.threads = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--budget") == 0 && value) {
+            options.budget_ms = atof(value);
+            i++;
+        } else if (strcmp(arg, "--profile-json") == 0 && value) {
+            options.profile_json = value;
+            i++;
+        } else if (strcmp(arg, "--profile-trace") == 0 && value) {
+            options.profile_trace = value;
+            i++;
+        } else {
+            return false;
+        }
+    }
+    return options.frames > 0 && window_width > 0 && window_height > 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (!parse_options(argc, argv)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    int result = 0;
+    if (options.headless) {
+        setup();
+        result = run_headless();
+        write_profile();
+        raster_scene_free(&raster_scene);
+        thread_pool_destroy(render_pool);
+        destroy_color_buffer();
+        return result;
+    }
+
+#ifndef TINY_RENDERER_NO_SDL
     is_running = initialize_window();
 
     setup();
@@ -274,7 +410,11 @@ int main(void) {
         SDL_Delay(16); // 约60 FPS
     }
 
+    write_profile();
+    raster_scene_free(&raster_scene);
+    thread_pool_destroy(render_pool);
     destroy_window();
+#endif
 
-    return 0;
+    return result;
 }
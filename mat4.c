@@ -0,0 +1,232 @@
+#include "mat4.h"
+#include <math.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MAT4_USE_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MAT4_USE_SSE 1
+#endif
+
+mat4_t mat4_identity(void) {
+    return (mat4_t){{
+        {1, 0, 0, 0},
+        {0, 1, 0, 0},
+        {0, 0, 1, 0},
+        {0, 0, 0, 1}
+    }};
+}
+
+mat4_t mat4_make_translation(vec3_t translation) {
+    return (mat4_t){{
+        {1, 0, 0, translation.x},
+        {0, 1, 0, translation.y},
+        {0, 0, 1, translation.z},
+        {0, 0, 0, 1}
+    }};
+}
+
+mat4_t mat4_make_scaling(float scale) {
+    return (mat4_t){{
+        {scale, 0,     0,     0},
+        {0,     scale, 0,     0},
+        {0,     0,     scale, 0},
+        {0,     0,     0,     1}
+    }};
+}
+
+mat4_t mat4_make_oy_rotation(float degrees) {
+    float rad = degrees * 3.14159265358979323846f / 180.0f;
+    float cos_theta = cosf(rad);
+    float sin_theta = sinf(rad);
+    return (mat4_t){{
+        {cos_theta, 0, -sin_theta, 0},
+        {0,         1, 0,          0},
+        {sin_theta, 0, cos_theta,  0},
+        {0,         0, 0,          1}
+    }};
+}
+
+// 结果的第i行 = sum_k a[i][k] * b的第k行，k从0到3依次累加，
+// 与matrix_mul的求和顺序相同，三种实现结果逐位一致
+mat4_t mat4_mul(mat4_t a, mat4_t b) {
+    mat4_t r;
+#if defined(MAT4_USE_AVX)
+    // 一次计算两行：低128位为第i行，高128位为第i+1行
+    __m256 rows[4];
+    for (int k = 0; k < 4; k++) {
+        __m128 row = _mm_loadu_ps(b.m[k]);
+        rows[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(row), row, 1);
+    }
+    for (int i = 0; i < 4; i += 2) {
+        __m256 sum = _mm256_mul_ps(_mm256_setr_ps(
+            a.m[i][0], a.m[i][0], a.m[i][0], a.m[i][0],
+            a.m[i + 1][0], a.m[i + 1][0], a.m[i + 1][0], a.m[i + 1][0]), rows[0]);
+        for (int k = 1; k < 4; k++) {
+            __m256 s = _mm256_setr_ps(
+                a.m[i][k], a.m[i][k], a.m[i][k], a.m[i][k],
+                a.m[i + 1][k], a.m[i + 1][k], a.m[i + 1][k], a.m[i + 1][k]);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(s, rows[k]));
+        }
+        _mm_storeu_ps(r.m[i], _mm256_castps256_ps128(sum));
+        _mm_storeu_ps(r.m[i + 1], _mm256_extractf128_ps(sum, 1));
+    }
+#elif defined(MAT4_USE_SSE)
+    __m128 rows[4];
+    for (int k = 0; k < 4; k++) rows[k] = _mm_loadu_ps(b.m[k]);
+    for (int i = 0; i < 4; i++) {
+        __m128 sum = _mm_mul_ps(_mm_set1_ps(a.m[i][0]), rows[0]);
+        for (int k = 1; k < 4; k++) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a.m[i][k]), rows[k]));
+        }
+        _mm_storeu_ps(r.m[i], sum);
+    }
+#else
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            float sum = a.m[i][0] * b.m[0][j];
+            for (int k = 1; k < 4; k++) sum += a.m[i][k] * b.m[k][j];
+            r.m[i][j] = sum;
+        }
+    }
+#endif
+    return r;
+}
+
+mat4_t mat4_compose(vec3_t translation, mat4_t rotation, float scale) {
+    return mat4_mul(mat4_make_translation(translation), mat4_mul(rotation, mat4_make_scaling(scale)));
+}
+
+mat4_t mat4_transpose(mat4_t mat) {
+    mat4_t r;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) r.m[j][i] = mat.m[i][j];
+    }
+    return r;
+}
+
+// 伴随矩阵法：先求2x2子式，再组合出全部余子式
+bool mat4_inverse(mat4_t mat, mat4_t* out) {
+    float (*m)[4] = mat.m;
+    float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+    float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+    float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (det == 0.0f || !isfinite(det)) return false;
+    float inv = 1.0f / det;
+    mat4_t r;
+    r.m[0][0] = ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * inv;
+    r.m[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * inv;
+    r.m[0][2] = ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * inv;
+    r.m[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * inv;
+    r.m[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * inv;
+    r.m[1][1] = ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * inv;
+    r.m[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * inv;
+    r.m[1][3] = ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * inv;
+    r.m[2][0] = ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * inv;
+    r.m[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * inv;
+    r.m[2][2] = ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * inv;
+    r.m[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * inv;
+    r.m[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * inv;
+    r.m[3][1] = ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * inv;
+    r.m[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * inv;
+    r.m[3][3] = ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * inv;
+    *out = r;
+    return true;
+}
+
+// 与matrix_mul_vec4的计算顺序相同
+vec4_t mat4_mul_vec4(const mat4_t* mat, vec4_t v) {
+    const float (*m)[4] = mat->m;
+    return (vec4_t){
+        m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + m[0][3] * v.w,
+        m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + m[1][3] * v.w,
+        m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3] * v.w,
+        m[3][0] * v.x + m[3][1] * v.y + m[3][2] * v.z + m[3][3] * v.w
+    };
+}
+
+vec3_t mat4_transform_point(const mat4_t* mat, vec3_t p) {
+    const float (*m)[4] = mat->m;
+    return (vec3_t){
+        m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+        m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+        m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]
+    };
+}
+
+mat3_t mat3_identity(void) {
+    return (mat3_t){{
+        {1, 0, 0},
+        {0, 1, 0},
+        {0, 0, 1}
+    }};
+}
+
+mat3_t mat3_from_mat4(const mat4_t* mat) {
+    mat3_t r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) r.m[i][j] = mat->m[i][j];
+    }
+    return r;
+}
+
+mat3_t mat3_mul(mat3_t a, mat3_t b) {
+    mat3_t r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+        }
+    }
+    return r;
+}
+
+mat3_t mat3_transpose(mat3_t mat) {
+    mat3_t r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) r.m[j][i] = mat.m[i][j];
+    }
+    return r;
+}
+
+bool mat3_inverse(mat3_t mat, mat3_t* out) {
+    float (*m)[3] = mat.m;
+    float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+    if (det == 0.0f || !isfinite(det)) return false;
+    float inv = 1.0f / det;
+    mat3_t r;
+    r.m[0][0] = c00 * inv;
+    r.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+    r.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+    r.m[1][0] = c01 * inv;
+    r.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+    r.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+    r.m[2][0] = c02 * inv;
+    r.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+    r.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+    *out = r;
+    return true;
+}
+
+// 与matrix_mul_vec3的计算顺序相同
+vec3_t mat3_mul_vec3(const mat3_t* mat, vec3_t v) {
+    const float (*m)[3] = mat->m;
+    return (vec3_t){
+        m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+        m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+        m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z
+    };
+}
@@ -0,0 +1,52 @@
+#ifndef MAT4_H
+#define MAT4_H
+
+#include <stdbool.h>
+#include "vector.h"
+
+// 固定大小的值类型矩阵，行优先存储，与matrix_t的约定相同（列向量，v' = M * v）
+// 按值传递和返回，不分配堆内存；任意大小的矩阵仍使用matrix.h中的matrix_t
+
+typedef struct {
+    float m[4][4];
+} mat4_t;
+
+typedef struct {
+    float m[3][3];
+} mat3_t;
+
+// 单位矩阵
+mat4_t mat4_identity(void);
+// 平移变换
+mat4_t mat4_make_translation(vec3_t translation);
+// 均匀缩放变换
+mat4_t mat4_make_scaling(float scale);
+// 绕Y轴旋转（角度制），与matrix_make_oy_rotation相同
+mat4_t mat4_make_oy_rotation(float degrees);
+// 矩阵乘法 a * b（先应用b，再应用a）
+mat4_t mat4_mul(mat4_t a, mat4_t b);
+// 组合实例变换：平移 * 旋转 * 缩放
+mat4_t mat4_compose(vec3_t translation, mat4_t rotation, float scale);
+// 矩阵转置
+mat4_t mat4_transpose(mat4_t mat);
+// 逆矩阵，矩阵奇异时返回false，*out不变
+bool mat4_inverse(mat4_t mat, mat4_t* out);
+// 矩阵与vec4_t相乘
+vec4_t mat4_mul_vec4(const mat4_t* mat, vec4_t v);
+// 变换点（w = 1），只取结果的前三维
+vec3_t mat4_transform_point(const mat4_t* mat, vec3_t p);
+
+// 单位矩阵
+mat3_t mat3_identity(void);
+// 取4x4矩阵左上角的3x3部分
+mat3_t mat3_from_mat4(const mat4_t* mat);
+// 矩阵乘法 a * b
+mat3_t mat3_mul(mat3_t a, mat3_t b);
+// 矩阵转置
+mat3_t mat3_transpose(mat3_t mat);
+// 逆矩阵，矩阵奇异时返回false，*out不变
+bool mat3_inverse(mat3_t mat, mat3_t* out);
+// 矩阵与vec3_t相乘
+vec3_t mat3_mul_vec3(const mat3_t* mat, vec3_t v);
+
+#endif // MAT4_H
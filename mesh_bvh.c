@@ -0,0 +1,302 @@
+#include "mesh_bvh.h"
+#include "aabb.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SAH_BIN_COUNT 16
+#define MESH_BVH_LEAF_SIZE 4
+#define BVH_STACK_SIZE 128
+// 超过该深度后改用对半划分，保证遍历栈不会溢出
+#define BVH_MAX_SAH_DEPTH 48
+
+typedef struct {
+    mesh_bvh_t* bvh;
+    int* refs;          // 三角形下标，构建过程中按划分结果重排
+    vec3_t* centroids;  // 每个三角形包围盒的中心
+    aabb_t* bounds;     // 每个三角形的包围盒
+} mesh_build_t;
+
+static int centroid_bin(vec3_t c, int axis, float lo, float scale) {
+    int b = (int)((vec3_axis(c, axis) - lo) * scale);
+    if (b < 0) b = 0;
+    if (b >= SAH_BIN_COUNT) b = SAH_BIN_COUNT - 1;
+    return b;
+}
+
+static void build_node(mesh_build_t* ctx, int node_index, int begin, int end, int depth) {
+    mesh_bvh_t* bvh = ctx->bvh;
+    aabb_t bounds = aabb_empty();
+    aabb_t centroid_bounds = aabb_empty();
+    for (int i = begin; i < end; i++) {
+        int t = ctx->refs[i];
+        aabb_grow(&bounds, ctx->bounds[t].min, ctx->bounds[t].max);
+        aabb_grow(&centroid_bounds, ctx->centroids[t], ctx->centroids[t]);
+    }
+    bvh->nodes[node_index].min = bounds.min;
+    bvh->nodes[node_index].max = bounds.max;
+
+    int n = end - begin;
+    if (n <= MESH_BVH_LEAF_SIZE) {
+        bvh->nodes[node_index].first = begin;
+        bvh->nodes[node_index].count = n;
+        return;
+    }
+
+    // 在三个轴上分箱，选SAH代价最小的划分
+    int best_axis = -1, best_split = 0;
+    float best_cost = INFINITY;
+    if (depth < BVH_MAX_SAH_DEPTH) {
+        for (int axis = 0; axis < 3; axis++) {
+            float lo = vec3_axis(centroid_bounds.min, axis);
+            float hi = vec3_axis(centroid_bounds.max, axis);
+            if (hi <= lo) continue;
+            float scale = SAH_BIN_COUNT / (hi - lo);
+
+            aabb_t bin_bounds[SAH_BIN_COUNT];
+            int bin_count[SAH_BIN_COUNT] = {0};
+            for (int b = 0; b < SAH_BIN_COUNT; b++) bin_bounds[b] = aabb_empty();
+            for (int i = begin; i < end; i++) {
+                int t = ctx->refs[i];
+                int b = centroid_bin(ctx->centroids[t], axis, lo, scale);
+                aabb_grow(&bin_bounds[b], ctx->bounds[t].min, ctx->bounds[t].max);
+                bin_count[b]++;
+            }
+
+            float right_area[SAH_BIN_COUNT];
+            int right_count[SAH_BIN_COUNT];
+            aabb_t acc = aabb_empty();
+            int cnt = 0;
+            for (int b = SAH_BIN_COUNT - 1; b > 0; b--) {
+                aabb_grow(&acc, bin_bounds[b].min, bin_bounds[b].max);
+                cnt += bin_count[b];
+                right_area[b] = aabb_area(acc);
+                right_count[b] = cnt;
+            }
+            acc = aabb_empty();
+            cnt = 0;
+            for (int b = 1; b < SAH_BIN_COUNT; b++) {
+                aabb_grow(&acc, bin_bounds[b - 1].min, bin_bounds[b - 1].max);
+                cnt += bin_count[b - 1];
+                if (cnt == 0 || right_count[b] == 0) continue;
+                float cost = aabb_area(acc) * cnt + right_area[b] * right_count[b];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b;
+                }
+            }
+        }
+    }
+
+    int mid = begin + n / 2;
+    int axis = 0;
+    if (best_axis >= 0) {
+        axis = best_axis;
+        float lo = vec3_axis(centroid_bounds.min, axis);
+        float scale = SAH_BIN_COUNT / (vec3_axis(centroid_bounds.max, axis) - lo);
+        int i = begin, j = end - 1;
+        while (i <= j) {
+            if (centroid_bin(ctx->centroids[ctx->refs[i]], axis, lo, scale) < best_split) {
+                i++;
+            } else {
+                int tmp = ctx->refs[i];
+                ctx->refs[i] = ctx->refs[j];
+                ctx->refs[j--] = tmp;
+            }
+        }
+        if (i > begin && i < end) mid = i;
+    }
+
+    // 兄弟节点成对分配在偶数下标，共享一条缓存行
+    int left = bvh->node_count;
+    bvh->node_count += 2;
+    bvh->nodes[node_index].first = left;
+    bvh->nodes[node_index].count = -1 - axis;
+    build_node(ctx, left, begin, mid, depth + 1);
+    build_node(ctx, left + 1, mid, end, depth + 1);
+}
+
+void mesh_bvh_free(mesh_bvh_t* bvh) {
+    free(bvh->nodes);
+    free(bvh->triangles);
+    *bvh = (mesh_bvh_t){0};
+}
+
+bool mesh_bvh_build(mesh_bvh_t* bvh, const model_t* model) {
+    *bvh = (mesh_bvh_t){0};
+    bvh->model = model;
+    int n = model->triangle_count;
+    if (n <= 0) return true;
+
+    mesh_build_t ctx = {
+        bvh,
+        malloc(sizeof(int) * n),
+        malloc(sizeof(vec3_t) * n),
+        malloc(sizeof(aabb_t) * n),
+    };
+    // 根节点占0号，1号空出使之后的兄弟节点对齐到缓存行
+    size_t node_bytes = sizeof(mesh_bvh_node_t) * 2 * (size_t)n;
+    node_bytes = (node_bytes + 63) / 64 * 64;
+    bvh->nodes = aligned_alloc(64, node_bytes);
+    bvh->triangles = malloc(sizeof(mesh_bvh_triangle_t) * n);
+    if (!ctx.refs || !ctx.centroids || !ctx.bounds || !bvh->nodes || !bvh->triangles) {
+        free(ctx.refs);
+        free(ctx.centroids);
+        free(ctx.bounds);
+        mesh_bvh_free(bvh);
+        return false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const triangle_t* tri = &model->triangles[i];
+        vec3_t v0 = model->vertexes[tri->v0];
+        vec3_t v1 = model->vertexes[tri->v1];
+        vec3_t v2 = model->vertexes[tri->v2];
+        aabb_t box = aabb_empty();
+        aabb_grow(&box, v0, v0);
+        aabb_grow(&box, v1, v1);
+        aabb_grow(&box, v2, v2);
+        ctx.bounds[i] = box;
+        ctx.centroids[i] = vec3_scale(vec3_add(box.min, box.max), 0.5f);
+        ctx.refs[i] = i;
+    }
+
+    bvh->node_count = 2;
+    build_node(&ctx, 0, 0, n, 0);
+
+    // 按叶子顺序复制三角形顶点
+    for (int i = 0; i < n; i++) {
+        const triangle_t* tri = &model->triangles[ctx.refs[i]];
+        bvh->triangles[i] = (mesh_bvh_triangle_t){
+            model->vertexes[tri->v0], model->vertexes[tri->v1], model->vertexes[tri->v2], ctx.refs[i]
+        };
+    }
+    bvh->triangle_count = n;
+
+    free(ctx.refs);
+    free(ctx.centroids);
+    free(ctx.bounds);
+    return true;
+}
+
+// 水密光线-三角形求交（Woop等人的方法）所需的每条光线的预计算数据
+// 将光线方向最大分量所在轴作为z轴，剪切变换后在二维平面上用边函数判断，共享边上不会漏掉或重复命中
+typedef struct {
+    vec3_t origin;
+    vec3_t inv_dir;
+    int kx, ky, kz;
+    float sx, sy, sz;
+} watertight_ray_t;
+
+static watertight_ray_t prepare_ray(vec3_t origin, vec3_t direction) {
+    watertight_ray_t ray;
+    ray.origin = origin;
+    ray.inv_dir = (vec3_t){1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+    float ax = fabsf(direction.x), ay = fabsf(direction.y), az = fabsf(direction.z);
+    ray.kz = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+    ray.kx = (ray.kz + 1) % 3;
+    ray.ky = (ray.kx + 1) % 3;
+    // 保持三角形的绕序
+    float dz = vec3_axis(direction, ray.kz);
+    if (dz < 0) {
+        int tmp = ray.kx;
+        ray.kx = ray.ky;
+        ray.ky = tmp;
+    }
+    ray.sx = vec3_axis(direction, ray.kx) / dz;
+    ray.sy = vec3_axis(direction, ray.ky) / dz;
+    ray.sz = 1.0f / dz;
+    return ray;
+}
+
+static inline bool intersect_triangle(const watertight_ray_t* ray, const mesh_bvh_triangle_t* tri,
+                                      float t_min, float t_max, float* out_t) {
+    vec3_t a = vec3_sub(tri->v0, ray->origin);
+    vec3_t b = vec3_sub(tri->v1, ray->origin);
+    vec3_t c = vec3_sub(tri->v2, ray->origin);
+    float a3[3] = {a.x, a.y, a.z};
+    float b3[3] = {b.x, b.y, b.z};
+    float c3[3] = {c.x, c.y, c.z};
+
+    float ax = a3[ray->kx] - ray->sx * a3[ray->kz];
+    float ay = a3[ray->ky] - ray->sy * a3[ray->kz];
+    float bx = b3[ray->kx] - ray->sx * b3[ray->kz];
+    float by = b3[ray->ky] - ray->sy * b3[ray->kz];
+    float cx = c3[ray->kx] - ray->sx * c3[ray->kz];
+    float cy = c3[ray->ky] - ray->sy * c3[ray->kz];
+
+    float u = cx * by - cy * bx;
+    float v = ax * cy - ay * cx;
+    float w = bx * ay - by * ax;
+    // 恰好落在边上时用双精度重新计算，保证水密性
+    if (u == 0.0f || v == 0.0f || w == 0.0f) {
+        u = (float)((double)cx * by - (double)cy * bx);
+        v = (float)((double)ax * cy - (double)ay * cx);
+        w = (float)((double)bx * ay - (double)by * ax);
+    }
+    if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0)) return false;
+    float det = u + v + w;
+    if (det == 0.0f) return false;
+
+    float az = ray->sz * a3[ray->kz];
+    float bz = ray->sz * b3[ray->kz];
+    float cz = ray->sz * c3[ray->kz];
+    float t = (u * az + v * bz + w * cz) / det;
+    if (!(t_min < t && t < t_max)) return false;
+    *out_t = t;
+    return true;
+}
+
+int mesh_bvh_closest(const mesh_bvh_t* bvh, vec3_t origin, vec3_t direction,
+                     float min_t, float* inout_t) {
+    if (bvh->triangle_count == 0) return -1;
+    watertight_ray_t ray = prepare_ray(origin, direction);
+    float best_t = *inout_t;
+    int best = -1;
+    int stack[BVH_STACK_SIZE];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const mesh_bvh_node_t* node = &bvh->nodes[stack[--sp]];
+        if (!ray_hits_aabb(node->min, node->max, origin, ray.inv_dir, min_t, best_t)) continue;
+        if (node->count > 0) {
+            for (int i = node->first; i < node->first + node->count; i++) {
+                float t;
+                if (intersect_triangle(&ray, &bvh->triangles[i], min_t, best_t, &t)) {
+                    best_t = t;
+                    best = bvh->triangles[i].index;
+                }
+            }
+        } else {
+            // 沿划分轴先访问近处的子节点
+            bool near_is_left = vec3_axis(direction, -1 - node->count) >= 0;
+            stack[sp++] = near_is_left ? node->first + 1 : node->first;
+            stack[sp++] = near_is_left ? node->first : node->first + 1;
+        }
+    }
+    *inout_t = best_t;
+    return best;
+}
+
+bool mesh_bvh_occluded(const mesh_bvh_t* bvh, vec3_t origin, vec3_t direction,
+                       float min_t, float max_t) {
+    if (bvh->triangle_count == 0) return false;
+    watertight_ray_t ray = prepare_ray(origin, direction);
+    int stack[BVH_STACK_SIZE];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const mesh_bvh_node_t* node = &bvh->nodes[stack[--sp]];
+        if (!ray_hits_aabb(node->min, node->max, origin, ray.inv_dir, min_t, max_t)) continue;
+        if (node->count > 0) {
+            for (int i = node->first; i < node->first + node->count; i++) {
+                float t;
+                if (intersect_triangle(&ray, &bvh->triangles[i], min_t, max_t, &t)) return true;
+            }
+        } else {
+            stack[sp++] = node->first + 1;
+            stack[sp++] = node->first;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,45 @@
+#ifndef MESH_BVH_H
+#define MESH_BVH_H
+
+#include <stdbool.h>
+#include "vector.h"
+#include "geometry.h"
+
+// 三角形网格的紧凑BVH
+// 节点32字节，节点数组按64字节对齐，兄弟节点（偶数下标开始）共享一条缓存行
+// 叶子节点：first为第一个三角形（按叶子顺序），count为三角形数
+// 内部节点：first为左子节点下标（右子节点为first+1），count为-1-划分轴
+typedef struct {
+    vec3_t min;
+    int first;
+    vec3_t max;
+    int count;
+} mesh_bvh_node_t;
+
+// 按叶子顺序存放的三角形顶点，求交时不再经过顶点下标间接访问
+typedef struct {
+    vec3_t v0, v1, v2;
+    int index;          // 原模型中的三角形下标
+} mesh_bvh_triangle_t;
+
+typedef struct {
+    const model_t* model;
+    mesh_bvh_node_t* nodes;
+    int node_count;
+    mesh_bvh_triangle_t* triangles;
+    int triangle_count;
+} mesh_bvh_t;
+
+// 为模型构建BVH（顶点视为世界坐标），使用分箱SAH
+bool mesh_bvh_build(mesh_bvh_t* bvh, const model_t* model);
+void mesh_bvh_free(mesh_bvh_t* bvh);
+
+// 返回(min_t, *inout_t)内最近交点所在的原三角形下标并更新*inout_t，无交点时返回-1
+int mesh_bvh_closest(const mesh_bvh_t* bvh, vec3_t origin, vec3_t direction,
+                     float min_t, float* inout_t);
+
+// 遮挡查询：(min_t, max_t)内有任意交点即返回true
+bool mesh_bvh_occluded(const mesh_bvh_t* bvh, vec3_t origin, vec3_t direction,
+                       float min_t, float max_t);
+
+#endif // MESH_BVH_H
@@ -0,0 +1,595 @@
+#define _POSIX_C_SOURCE 200809L
+#include "model_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#pragma region OBJ解析
+
+// 读缓冲区大小，单行不能超过此长度
+#define OBJ_BUFFER_SIZE (1 << 20)
+
+// 按倍增扩容的数组，元素大小为size
+typedef struct {
+    void* data;
+    int count, capacity;
+    size_t size;
+} obj_array_t;
+
+// 追加一个元素并返回其地址，内存不足或超出int范围时返回NULL
+static void* array_push(obj_array_t* array) {
+    if (array->count == array->capacity) {
+        if (array->capacity > INT_MAX / 2) return NULL;
+        int capacity = array->capacity ? array->capacity * 2 : 1024;
+        void* data = realloc(array->data, array->size * (size_t)capacity);
+        if (!data) return NULL;
+        array->data = data;
+        array->capacity = capacity;
+    }
+    return (char*)array->data + array->size * (size_t)array->count++;
+}
+
+typedef struct {
+    obj_array_t positions;      // v
+    obj_array_t texcoords;      // vt
+    obj_array_t normals;        // vn
+    obj_array_t keys;           // 每个输出顶点的(v, vt, vn)下标，没有的为-1
+    obj_array_t triangles;
+    // 开放寻址的哈希表：(v, vt, vn) -> 输出顶点下标，-1为空
+    int* slots;
+    int slot_mask;
+    bool has_texcoords, has_normals;
+} obj_parser_t;
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char* skip_space(const char* s, const char* end) {
+    while (s < end && is_space(*s)) s++;
+    return s;
+}
+
+// 10的非负整数次幂在此范围内可用double精确表示
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// 解析十进制浮点数（可带符号、小数点和指数），不依赖区域设置，失败时返回NULL
+// 前19位有效数字累加为整数，再乘以或除以10的幂；指数不超过22时只有一次舍入
+static const char* parse_float(const char* s, const char* end, float* out) {
+    s = skip_space(s, end);
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for (; s < end && *s >= '0' && *s <= '9'; s++, any = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+            if (mantissa) digits++;
+        } else {
+            exponent++;
+        }
+    }
+    if (s < end && *s == '.') {
+        for (s++; s < end && *s >= '0' && *s <= '9'; s++, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+                if (mantissa) digits++;
+                exponent--;
+            }
+        }
+    }
+    if (!any) return NULL;
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* p = s + 1;
+        bool exp_negative = false;
+        if (p < end && (*p == '-' || *p == '+')) exp_negative = *p++ == '-';
+        if (p < end && *p >= '0' && *p <= '9') {
+            int e = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; p++) {
+                if (e < 10000) e = e * 10 + (*p - '0');
+            }
+            exponent += exp_negative ? -e : e;
+            s = p;
+        }
+    }
+    double value = (double)mantissa;
+    if (mantissa != 0) {
+        if (exponent > 0) {
+            value = exponent <= 22 ? value * powers_of_ten[exponent] : value * pow(10.0, exponent);
+        } else if (exponent < 0) {
+            value = exponent >= -22 ? value / powers_of_ten[-exponent] : value * pow(10.0, exponent);
+        }
+    }
+    *out = (float)(negative ? -value : value);
+    return s;
+}
+
+// 解析面的一个下标：正数从1开始，负数相对于已有的count个元素，结果转为从0开始，越界时返回NULL
+static const char* parse_index(const char* s, const char* end, int count, int* out) {
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+    if (s == end || *s < '0' || *s > '9') return NULL;
+    int64_t value = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; s++) {
+        if (value <= INT_MAX) value = value * 10 + (*s - '0');
+    }
+    int64_t index = negative ? count - value : value - 1;
+    if (value == 0 || index < 0 || index >= count) return NULL;
+    *out = (int)index;
+    return s;
+}
+
+static inline uint32_t hash_key(const int* key) {
+    uint32_t h = (uint32_t)key[0] * 0x9E3779B1u;
+    h ^= (uint32_t)key[1] * 0x85EBCA77u + (h << 6) + (h >> 2);
+    h ^= (uint32_t)key[2] * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+    return h ^ (h >> 15);
+}
+
+// 哈希表扩容到输出顶点数的4倍以上（装载率不超过1/2），按已有的键重新插入
+static bool grow_slots(obj_parser_t* p) {
+    int capacity = p->slots ? (p->slot_mask + 1) * 2 : 4096;
+    if (capacity <= 0 || capacity > INT_MAX / 2) return false;
+    int* slots = malloc(sizeof(int) * (size_t)capacity);
+    if (!slots) return false;
+    memset(slots, 0xFF, sizeof(int) * (size_t)capacity);
+    int mask = capacity - 1;
+    const int (*keys)[3] = p->keys.data;
+    for (int i = 0; i < p->keys.count; i++) {
+        uint32_t h = hash_key(keys[i]) & (uint32_t)mask;
+        while (slots[h] >= 0) h = (h + 1) & (uint32_t)mask;
+        slots[h] = i;
+    }
+    free(p->slots);
+    p->slots = slots;
+    p->slot_mask = mask;
+    return true;
+}
+
+// 返回(v, vt, vn)组合对应的输出顶点，第一次出现时追加，失败时返回-1
+static int find_or_add_vertex(obj_parser_t* p, const int* key) {
+    if (!p->slots || (p->keys.count + 1) * 2 > p->slot_mask + 1) {
+        if (!grow_slots(p)) return -1;
+    }
+    const int (*keys)[3] = p->keys.data;
+    uint32_t h = hash_key(key) & (uint32_t)p->slot_mask;
+    for (;; h = (h + 1) & (uint32_t)p->slot_mask) {
+        int index = p->slots[h];
+        if (index < 0) break;
+        if (keys[index][0] == key[0] && keys[index][1] == key[1] && keys[index][2] == key[2]) return index;
+    }
+    int* slot = array_push(&p->keys);
+    if (!slot) return -1;
+    memcpy(slot, key, sizeof(int) * 3);
+    p->slots[h] = p->keys.count - 1;
+    return p->keys.count - 1;
+}
+
+// 面：多边形按扇形三角化；z取反是镜像，会反转环绕方向，因此每个三角形的后两个顶点交换
+static bool parse_face(obj_parser_t* p, const char* s, const char* end) {
+    int first = -1, prev = -1, corners = 0;
+    for (;;) {
+        s = skip_space(s, end);
+        if (s == end || *s == '#') break;
+        int key[3] = {-1, -1, -1};
+        if (!(s = parse_index(s, end, p->positions.count, &key[0]))) return false;
+        if (s < end && *s == '/') {
+            s++;
+            if (s < end && *s != '/') {
+                if (!(s = parse_index(s, end, p->texcoords.count, &key[1]))) return false;
+                p->has_texcoords = true;
+            }
+            if (s < end && *s == '/') {
+                if (!(s = parse_index(s + 1, end, p->normals.count, &key[2]))) return false;
+                p->has_normals = true;
+            }
+        }
+        if (s < end && !is_space(*s)) return false;
+        int index = find_or_add_vertex(p, key);
+        if (index < 0) return false;
+        if (corners == 0) {
+            first = index;
+        } else if (corners >= 2) {
+            triangle_t* t = array_push(&p->triangles);
+            if (!t) return false;
+            *t = (triangle_t){first, index, prev, MODEL_OBJ_COLOR};
+        }
+        prev = index;
+        corners++;
+    }
+    return true;
+}
+
+// 解析一行（不含换行符），遇到格式错误或内存不足时返回false
+static bool parse_line(obj_parser_t* p, const char* s, const char* end) {
+    s = skip_space(s, end);
+    // 关键字：v、vt、vn或f，后面须跟空白
+    const char* keyword = s;
+    while (s < end && !is_space(*s)) s++;
+    size_t length = (size_t)(s - keyword);
+    if (length == 0 || length > 2) return true;
+    if (length == 1 && keyword[0] == 'f') return parse_face(p, s, end);
+    if (keyword[0] != 'v') return true;
+    if (length == 1) {
+        vec3_t v;
+        if (!(s = parse_float(s, end, &v.x)) || !(s = parse_float(s, end, &v.y)) ||
+            !parse_float(s, end, &v.z)) return false;
+        vec3_t* out = array_push(&p->positions);
+        if (!out) return false;
+        *out = (vec3_t){v.x, v.y, -v.z};
+    } else if (keyword[1] == 'n') {
+        vec3_t n;
+        if (!(s = parse_float(s, end, &n.x)) || !(s = parse_float(s, end, &n.y)) ||
+            !parse_float(s, end, &n.z)) return false;
+        vec3_t* out = array_push(&p->normals);
+        if (!out) return false;
+        *out = (vec3_t){n.x, n.y, -n.z};
+    } else if (keyword[1] == 't') {
+        // v缺省为0，第三个分量（如果有）忽略；OBJ的v以下边为0，纹理的v以上边为0
+        vec2_t uv = {0, 0};
+        if (!(s = parse_float(s, end, &uv.x))) return false;
+        s = skip_space(s, end);
+        if (s < end && *s != '#' && !parse_float(s, end, &uv.y)) return false;
+        vec2_t* out = array_push(&p->texcoords);
+        if (!out) return false;
+        *out = (vec2_t){uv.x, 1.0f - uv.y};
+    }
+    return true;
+}
+
+static void free_parser(obj_parser_t* p) {
+    free(p->positions.data);
+    free(p->texcoords.data);
+    free(p->normals.data);
+    free(p->keys.data);
+    free(p->triangles.data);
+    free(p->slots);
+}
+
+// 按去重后的顶点生成model_t的数组，成功后三角形数组归model所有
+static bool build_model(obj_parser_t* p, model_t* model) {
+    int count = p->keys.count;
+    const int (*keys)[3] = p->keys.data;
+    const vec3_t* positions = p->positions.data;
+    const vec2_t* texcoords = p->texcoords.data;
+    const vec3_t* normals = p->normals.data;
+    size_t n = count > 0 ? (size_t)count : 1;
+    vec3_t* vertexes = malloc(sizeof(vec3_t) * n);
+    vec2_t* uvs = p->has_texcoords ? malloc(sizeof(vec2_t) * n) : NULL;
+    vec3_t* vertex_normals = p->has_normals ? malloc(sizeof(vec3_t) * n) : NULL;
+    if (!vertexes || (p->has_texcoords && !uvs) || (p->has_normals && !vertex_normals)) {
+        free(vertexes);
+        free(uvs);
+        free(vertex_normals);
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        vertexes[i] = positions[keys[i][0]];
+        if (uvs) uvs[i] = keys[i][1] >= 0 ? texcoords[keys[i][1]] : (vec2_t){0, 0};
+        if (vertex_normals) vertex_normals[i] = keys[i][2] >= 0 ? normals[keys[i][2]] : (vec3_t){0, 0, 0};
+    }
+    triangle_t* triangles = p->triangles.data;
+    if (p->triangles.count > 0 && p->triangles.count < p->triangles.capacity) {
+        // 释放倍增扩容多出的部分
+        triangle_t* shrunk = realloc(triangles, sizeof(triangle_t) * (size_t)p->triangles.count);
+        if (shrunk) triangles = shrunk;
+    }
+    p->triangles.data = NULL;
+    *model = model_make(vertexes, count, triangles, p->triangles.count);
+    model->normals = vertex_normals;
+    model->uvs = uvs;
+    return true;
+}
+
+static void free_model_arrays(model_t* model) {
+    model_free_soa(model);
+    free(model->vertexes);
+    free(model->triangles);
+    free(model->normals);
+    free(model->uvs);
+    free(model->colors);
+}
+
+bool model_load_obj(const char* path, model_file_t* out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    char* buffer = malloc(OBJ_BUFFER_SIZE);
+    obj_parser_t p = {
+        .positions = {NULL, 0, 0, sizeof(vec3_t)},
+        .texcoords = {NULL, 0, 0, sizeof(vec2_t)},
+        .normals = {NULL, 0, 0, sizeof(vec3_t)},
+        .keys = {NULL, 0, 0, sizeof(int) * 3},
+        .triangles = {NULL, 0, 0, sizeof(triangle_t)}
+    };
+    bool ok = buffer != NULL;
+    size_t filled = 0;
+    while (ok) {
+        size_t n = fread(buffer + filled, 1, OBJ_BUFFER_SIZE - filled, f);
+        filled += n;
+        // 处理缓冲区中所有完整的行，不完整的最后一行移到开头，与下一次读入的数据拼接
+        const char* s = buffer;
+        const char* end = buffer + filled;
+        const char* newline;
+        while (ok && (newline = memchr(s, '\n', (size_t)(end - s))) != NULL) {
+            ok = parse_line(&p, s, newline);
+            s = newline + 1;
+        }
+        size_t rest = (size_t)(end - s);
+        if (n == 0) {
+            // 文件结束（最后一行可以没有换行符）或读取出错
+            ok = ok && !ferror(f) && (rest == 0 || parse_line(&p, s, end));
+            break;
+        }
+        if (rest == OBJ_BUFFER_SIZE) ok = false;
+        memmove(buffer, s, rest);
+        filled = rest;
+    }
+    fclose(f);
+    free(buffer);
+
+    model_t model = {0};
+    ok = ok && build_model(&p, &model);
+    free_parser(&p);
+    if (!ok) return false;
+    if (!model_build_soa(&model)) {
+        free_model_arrays(&model);
+        return false;
+    }
+    *out = (model_file_t){model, NULL, 0};
+    return true;
+}
+
+#pragma endregion
+
+#pragma region 二进制缓存
+
+#define MODEL_CACHE_MAGIC "TRMODEL"
+#define MODEL_CACHE_BYTE_ORDER 0x01020304u
+// 各段的对齐（缓存行，满足所有SIMD宽度的对齐加载）
+#define MODEL_CACHE_ALIGN 64
+// SoA补齐到最宽的SIMD宽度（AVX-512的16路），任何编译目标都可以直接使用
+#define MODEL_CACHE_SOA_PAD 16
+
+enum {
+    SECTION_VERTEXES,
+    SECTION_TRIANGLES,
+    SECTION_NORMALS,
+    SECTION_UVS,
+    SECTION_COLORS,
+    SECTION_SOA,            // x、y、z（有法向量时再加nx、ny、nz），每个数组soa_padded_count个float
+    SECTION_COUNT
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;        // 按本机字节序写入MODEL_CACHE_BYTE_ORDER
+    int32_t vertex_count;
+    int32_t triangle_count;
+    int32_t soa_padded_count;
+    int32_t reserved;
+    vec3_t bounds_center;
+    float bounds_radius;
+    uint64_t source_size;       // 源文件的大小和修改时间（秒），没有记录时均为0
+    int64_t source_mtime;
+    uint64_t file_size;
+    uint64_t offsets[SECTION_COUNT];    // 按MODEL_CACHE_ALIGN对齐，没有的段为0
+    uint64_t sizes[SECTION_COUNT];
+} model_cache_header_t;
+
+static uint64_t align_up(uint64_t v) {
+    return (v + MODEL_CACHE_ALIGN - 1) & ~(uint64_t)(MODEL_CACHE_ALIGN - 1);
+}
+
+static int soa_padded(int vertex_count) {
+    return (vertex_count + MODEL_CACHE_SOA_PAD - 1) / MODEL_CACHE_SOA_PAD * MODEL_CACHE_SOA_PAD;
+}
+
+// 各段按顺序紧跟在文件头之后，计算各段大小、偏移和文件大小
+static void cache_layout(model_cache_header_t* h, bool normals, bool uvs, bool colors) {
+    uint64_t v = (uint64_t)h->vertex_count;
+    h->sizes[SECTION_VERTEXES] = sizeof(vec3_t) * v;
+    h->sizes[SECTION_TRIANGLES] = sizeof(triangle_t) * (uint64_t)h->triangle_count;
+    h->sizes[SECTION_NORMALS] = normals ? sizeof(vec3_t) * v : 0;
+    h->sizes[SECTION_UVS] = uvs ? sizeof(vec2_t) * v : 0;
+    h->sizes[SECTION_COLORS] = colors ? sizeof(uint32_t) * v : 0;
+    h->sizes[SECTION_SOA] = sizeof(float) * (uint64_t)h->soa_padded_count * (normals ? 6 : 3);
+    uint64_t offset = align_up(sizeof(model_cache_header_t));
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        h->offsets[i] = h->sizes[i] ? offset : 0;
+        offset = align_up(offset + h->sizes[i]);
+    }
+    h->file_size = offset;
+}
+
+static bool stat_source(const char* path, uint64_t* size, int64_t* mtime) {
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+// 写一段数据并补零到下一个对齐位置
+static bool write_section(FILE* f, const void* data, uint64_t size) {
+    static const char zeros[MODEL_CACHE_ALIGN];
+    if (size && fwrite(data, 1, size, f) != size) return false;
+    uint64_t pad = align_up(size) - size;
+    return pad == 0 || fwrite(zeros, 1, pad, f) == pad;
+}
+
+// SoA的一个分量（补齐部分为0），按块转置写出
+static bool write_soa_component(FILE* f, const vec3_t* v, int count, int padded, int axis) {
+    float chunk[1024];
+    for (int i = 0; i < padded; i += 1024) {
+        int n = padded - i < 1024 ? padded - i : 1024;
+        for (int j = 0; j < n; j++) {
+            const float* p = &v[i + j].x;
+            chunk[j] = i + j < count ? p[axis] : 0.0f;
+        }
+        if (fwrite(chunk, sizeof(float), (size_t)n, f) != (size_t)n) return false;
+    }
+    return true;
+}
+
+bool model_write_cache(const char* path, const model_t* model, const char* source_path) {
+    model_cache_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MODEL_CACHE_MAGIC, sizeof(h.magic));
+    h.version = MODEL_CACHE_VERSION;
+    h.byte_order = MODEL_CACHE_BYTE_ORDER;
+    h.vertex_count = model->vertex_count;
+    h.triangle_count = model->triangle_count;
+    h.soa_padded_count = soa_padded(model->vertex_count);
+    h.bounds_center = model->bounds_center;
+    h.bounds_radius = model->bounds_radius;
+    if (source_path && !stat_source(source_path, &h.source_size, &h.source_mtime)) return false;
+    cache_layout(&h, model->normals != NULL, model->uvs != NULL, model->colors != NULL);
+
+    // 写到临时文件再改名，其他进程不会映射到写了一半的缓存
+    size_t length = strlen(path);
+    char* temp = malloc(length + 5);
+    if (!temp) return false;
+    memcpy(temp, path, length);
+    memcpy(temp + length, ".tmp", 5);
+    FILE* f = fopen(temp, "wb");
+    if (!f) {
+        free(temp);
+        return false;
+    }
+    int count = model->vertex_count, padded = h.soa_padded_count;
+    bool ok = write_section(f, &h, sizeof(h)) &&
+              write_section(f, model->vertexes, h.sizes[SECTION_VERTEXES]) &&
+              write_section(f, model->triangles, h.sizes[SECTION_TRIANGLES]) &&
+              write_section(f, model->normals, h.sizes[SECTION_NORMALS]) &&
+              write_section(f, model->uvs, h.sizes[SECTION_UVS]) &&
+              write_section(f, model->colors, h.sizes[SECTION_COLORS]);
+    for (int axis = 0; ok && axis < 3; axis++) ok = write_soa_component(f, model->vertexes, count, padded, axis);
+    for (int axis = 0; ok && model->normals && axis < 3; axis++) {
+        ok = write_soa_component(f, model->normals, count, padded, axis);
+    }
+    ok = ok && write_section(f, NULL, 0);
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(temp, path) == 0;
+    if (!ok) remove(temp);
+    free(temp);
+    return ok;
+}
+
+// 校验文件头：各段的位置、对齐和大小须与按计数重新计算的布局一致
+static bool validate_header(const model_cache_header_t* h, uint64_t file_size) {
+    if (memcmp(h->magic, MODEL_CACHE_MAGIC, sizeof(h->magic)) != 0) return false;
+    if (h->version != MODEL_CACHE_VERSION || h->byte_order != MODEL_CACHE_BYTE_ORDER) return false;
+    if (h->vertex_count < 0 || h->triangle_count < 0 || h->file_size != file_size) return false;
+    if (h->soa_padded_count != soa_padded(h->vertex_count)) return false;
+    model_cache_header_t expected = *h;
+    cache_layout(&expected, h->sizes[SECTION_NORMALS] != 0, h->sizes[SECTION_UVS] != 0,
+                 h->sizes[SECTION_COLORS] != 0);
+    return memcmp(expected.offsets, h->offsets, sizeof(h->offsets)) == 0 &&
+           memcmp(expected.sizes, h->sizes, sizeof(h->sizes)) == 0 &&
+           expected.file_size == file_size;
+}
+
+// 三角形的顶点下标都须在[0, vertex_count)内，损坏或不匹配的缓存不能让渲染器越界读取
+// 无符号比较把负数也视为越界；不提前退出，循环可以向量化
+static bool validate_triangles(const model_cache_header_t* h, const char* bytes) {
+    const triangle_t* triangles = (const triangle_t*)(bytes + h->offsets[SECTION_TRIANGLES]);
+    uint32_t count = (uint32_t)h->vertex_count;
+    bool bad = false;
+    for (int i = 0; i < h->triangle_count; i++) {
+        bad |= (uint32_t)triangles[i].v0 >= count;
+        bad |= (uint32_t)triangles[i].v1 >= count;
+        bad |= (uint32_t)triangles[i].v2 >= count;
+    }
+    return !bad;
+}
+
+bool model_map_cache(const char* path, const char* source_path, model_file_t* out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(model_cache_header_t) ||
+        (uint64_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    // 私有映射：页面按需从文件读入，写入时复制
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+
+    const model_cache_header_t* h = base;
+    bool ok = validate_header(h, size);
+    if (ok && source_path) {
+        uint64_t source_size;
+        int64_t source_mtime;
+        ok = stat_source(source_path, &source_size, &source_mtime) &&
+             source_size == h->source_size && source_mtime == h->source_mtime;
+    }
+    ok = ok && validate_triangles(h, base);
+    if (!ok) {
+        munmap(base, size);
+        return false;
+    }
+
+    char* bytes = base;
+    model_t model = {0};
+#define SECTION(i) (h->offsets[i] ? (void*)(bytes + h->offsets[i]) : NULL)
+    model.vertexes = SECTION(SECTION_VERTEXES);
+    model.vertex_count = h->vertex_count;
+    model.triangles = SECTION(SECTION_TRIANGLES);
+    model.triangle_count = h->triangle_count;
+    model.bounds_center = h->bounds_center;
+    model.bounds_radius = h->bounds_radius;
+    model.normals = SECTION(SECTION_NORMALS);
+    model.uvs = SECTION(SECTION_UVS);
+    model.colors = SECTION(SECTION_COLORS);
+    float* soa = SECTION(SECTION_SOA);
+#undef SECTION
+    if (soa) {
+        int padded = h->soa_padded_count;
+        model.soa.x = soa;
+        model.soa.y = soa + padded;
+        model.soa.z = soa + (size_t)padded * 2;
+        if (model.normals) {
+            model.soa.nx = soa + (size_t)padded * 3;
+            model.soa.ny = soa + (size_t)padded * 4;
+            model.soa.nz = soa + (size_t)padded * 5;
+        }
+        model.soa.padded_count = padded;
+    }
+    *out = (model_file_t){model, base, size};
+    return true;
+}
+
+bool model_load(const char* obj_path, const char* cache_path, model_file_t* out) {
+    // 只有缓存没有源文件时直接使用缓存
+    struct stat st;
+    bool have_source = stat(obj_path, &st) == 0;
+    if (model_map_cache(cache_path, have_source ? obj_path : NULL, out)) return true;
+    if (!have_source || !model_load_obj(obj_path, out)) return false;
+    model_write_cache(cache_path, &out->model, obj_path);
+    return true;
+}
+
+void model_file_free(model_file_t* file) {
+    if (file->mapping) {
+        munmap(file->mapping, file->mapping_size);
+    } else {
+        free_model_arrays(&file->model);
+    }
+    *file = (model_file_t){0};
+}
+
+#pragma endregion
@@ -0,0 +1,43 @@
+#ifndef MODEL_IO_H
+#define MODEL_IO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "geometry.h"
+
+// 从文件载入模型：流式解析OBJ文本，以及可直接mmap使用的二进制缓存
+// 缓存文件按本机的结构体布局和字节序存储，各数组按64字节对齐，映射后model的数组（含SoA副本）
+// 直接指向映射的内存，不解析也不复制；映射时校验文件头和三角形的顶点下标，不合法的缓存被拒绝
+
+#define MODEL_CACHE_VERSION 1
+
+typedef struct {
+    model_t model;
+    void* mapping;          // 映射的缓存文件，NULL表示数组由malloc分配
+    size_t mapping_size;
+} model_file_t;
+
+// 单遍流式解析OBJ：按固定大小的缓冲区读文件，行内不分配内存，数组按倍增扩容
+// 支持v、vt、vn和f（v、v/vt、v//vn、v/vt/vn，负数为相对下标，多边形按扇形三角化），其余语句忽略
+// OBJ的位置、纹理坐标和法向量分别编号，按(v, vt, vn)组合去重生成model_t的顶点
+// 面引用过vt/vn时生成uvs/normals数组，缺少的取0；OBJ为右手坐标系（-z朝前），载入时z取反并相应地反转三角形的环绕方向，
+// 纹理坐标的v取1 - v（OBJ以左下角为原点，vt省略v时取0）
+// OBJ没有逐面颜色，三角形颜色为MODEL_OBJ_COLOR（配合光照使用）；结果已计算包围球并生成SoA副本
+#define MODEL_OBJ_COLOR 0xFFFFFFFF
+bool model_load_obj(const char* path, model_file_t* out);
+
+// 写二进制缓存（先写临时文件再改名），source_path不为NULL时记录源文件的大小和修改时间用于判断过期
+bool model_write_cache(const char* path, const model_t* model, const char* source_path);
+
+// 映射缓存：校验魔数、版本、字节序、各段范围和三角形的顶点下标；source_path不为NULL时与记录的源文件大小和修改时间比较，
+// 不一致时视为过期返回false。映射为私有写时复制，修改数组只影响本进程
+bool model_map_cache(const char* path, const char* source_path, model_file_t* out);
+
+// 先映射cache_path，缓存缺失或过期时解析OBJ并重写缓存（写缓存失败不影响载入结果）
+bool model_load(const char* obj_path, const char* cache_path, model_file_t* out);
+
+// 释放载入的模型（解除映射或释放数组和SoA副本）
+void model_file_free(model_file_t* file);
+
+#endif // MODEL_IO_H
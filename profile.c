@@ -0,0 +1,172 @@
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* stage_names[PROFILE_STAGE_COUNT] = {
+    "frame",
+    "setup",
+    "transform",
+    "clip",
+    "bin",
+    "rasterize",
+    "rasterize_tile",
+    "raytrace",
+    "raytrace_tile",
+    "present",
+};
+
+static const char* counter_names[PROFILE_COUNTER_COUNT] = {
+    "triangles_in",
+    "instances_culled",
+    "triangles_clipped",
+    "triangles_culled",
+    "fragments_tested",
+    "depth_failed",
+    "hiz_tiles_rejected",
+    "hiz_blocks_rejected",
+    "rays_primary",
+    "rays_reflection",
+    "rays_shadow",
+};
+
+const char* profile_stage_name(profile_stage_t stage) {
+    return stage >= 0 && stage < PROFILE_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
+
+const char* profile_counter_name(profile_counter_t counter) {
+    return counter >= 0 && counter < PROFILE_COUNTER_COUNT ? counter_names[counter] : "unknown";
+}
+
+#ifdef TINY_RENDERER_PROFILE
+
+#include <pthread.h>
+
+_Thread_local profile_thread_t* profile_self = NULL;
+
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static profile_thread_t* threads = NULL;
+static int thread_count = 0;
+
+static double frame_start_ms = 0.0;
+static uint64_t frame_index = 0;
+static profile_frame_t last_frame;
+static bool has_last_frame = false;
+
+profile_thread_t* profile_register_thread(void) {
+    profile_thread_t* thread = calloc(1, sizeof(profile_thread_t));
+    if (!thread) abort();
+    pthread_mutex_lock(&threads_lock);
+    thread->id = thread_count++;
+    thread->next = threads;
+    threads = thread;
+    pthread_mutex_unlock(&threads_lock);
+    profile_self = thread;
+    return thread;
+}
+
+void profile_record(profile_thread_t* thread, profile_stage_t stage, double start_ms, double end_ms) {
+    thread->stage_ms[stage] += end_ms - start_ms;
+    thread->stage_calls[stage]++;
+    if (thread->event_count < PROFILE_MAX_EVENTS) {
+        thread->events[thread->event_count++] = (profile_event_t){stage, start_ms, end_ms};
+    } else {
+        thread->dropped_events++;
+    }
+}
+
+// 帧之间工作线程处于空闲状态（thread_pool_run已返回），主线程可以安全读写各线程的数据
+void profile_frame_begin(void) {
+    profile_thread();
+    pthread_mutex_lock(&threads_lock);
+    for (profile_thread_t* t = threads; t; t = t->next) {
+        memset(t->counters, 0, sizeof(t->counters));
+        memset(t->stage_ms, 0, sizeof(t->stage_ms));
+        memset(t->stage_calls, 0, sizeof(t->stage_calls));
+        t->event_count = 0;
+        t->dropped_events = 0;
+    }
+    pthread_mutex_unlock(&threads_lock);
+    frame_start_ms = time_now_ms();
+}
+
+void profile_frame_end(void) {
+    profile_record(profile_thread(), PROFILE_STAGE_FRAME, frame_start_ms, time_now_ms());
+
+    profile_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.index = frame_index++;
+    pthread_mutex_lock(&threads_lock);
+    for (profile_thread_t* t = threads; t; t = t->next) {
+        for (int i = 0; i < PROFILE_COUNTER_COUNT; i++) frame.counters[i] += t->counters[i];
+        for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+            frame.stage_ms[i] += t->stage_ms[i];
+            frame.stage_calls[i] += t->stage_calls[i];
+        }
+        frame.dropped_events += t->dropped_events;
+    }
+    pthread_mutex_unlock(&threads_lock);
+    frame.frame_ms = frame.stage_ms[PROFILE_STAGE_FRAME];
+    last_frame = frame;
+    has_last_frame = true;
+}
+
+bool profile_last_frame(profile_frame_t* out) {
+    if (!has_last_frame) return false;
+    *out = last_frame;
+    return true;
+}
+
+bool profile_write_chrome_trace(FILE* file) {
+    if (!has_last_frame) return false;
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    pthread_mutex_lock(&threads_lock);
+    for (profile_thread_t* t = threads; t; t = t->next) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+                first ? "" : ",\n", t->id, t->id == 0 ? "main" : "worker", t->id);
+        first = false;
+        for (uint32_t i = 0; i < t->event_count; i++) {
+            const profile_event_t* e = &t->events[i];
+            // 时间戳以微秒为单位，相对于帧开始
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    stage_names[e->stage], t->id,
+                    (e->start_ms - frame_start_ms) * 1000.0, (e->end_ms - e->start_ms) * 1000.0);
+        }
+    }
+    pthread_mutex_unlock(&threads_lock);
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    return !ferror(file);
+}
+
+#else
+
+bool profile_last_frame(profile_frame_t* out) {
+    (void)out;
+    return false;
+}
+
+bool profile_write_chrome_trace(FILE* file) {
+    (void)file;
+    return false;
+}
+
+#endif
+
+bool profile_write_json(FILE* file) {
+    profile_frame_t frame;
+    if (!profile_last_frame(&frame)) return false;
+    fprintf(file, "{\n  \"frame\": %llu,\n  \"frame_ms\": %.3f,\n  \"stages\": {\n",
+            (unsigned long long)frame.index, frame.frame_ms);
+    for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        fprintf(file, "    \"%s\": { \"ms\": %.3f, \"calls\": %u }%s\n",
+                stage_names[i], frame.stage_ms[i], frame.stage_calls[i],
+                i + 1 < PROFILE_STAGE_COUNT ? "," : "");
+    }
+    fprintf(file, "  },\n  \"counters\": {\n");
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+        fprintf(file, "    \"%s\": %llu%s\n", counter_names[i], (unsigned long long)frame.counters[i],
+                i + 1 < PROFILE_COUNTER_COUNT ? "," : "");
+    }
+    fprintf(file, "  },\n  \"dropped_events\": %u\n}\n", frame.dropped_events);
+    return !ferror(file);
+}
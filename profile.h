@@ -0,0 +1,114 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// 帧内分阶段计时和计数器
+// 定义TINY_RENDERER_PROFILE时启用，否则所有PROFILE_*宏展开为空，不产生任何开销
+// 计数和计时先累加到线程局部数据，帧结束时再汇总，工作线程之间没有争用
+
+typedef enum {
+    PROFILE_STAGE_FRAME,            // 整帧
+    PROFILE_STAGE_SETUP,            // render_scene中的相机和模型矩阵计算、包围球剔除
+    PROFILE_STAGE_TRANSFORM,        // 顶点变换
+    PROFILE_STAGE_CLIP,             // 裁剪
+    PROFILE_STAGE_BIN,              // 三角形设置和按图块装箱
+    PROFILE_STAGE_RASTERIZE,        // 一帧光栅化（所有图块）
+    PROFILE_STAGE_RASTERIZE_TILE,   // 单个光栅化图块（在工作线程上）
+    PROFILE_STAGE_RAYTRACE,         // 一帧光线追踪
+    PROFILE_STAGE_RAYTRACE_TILE,    // 单个光线追踪图块（在工作线程上）
+    PROFILE_STAGE_PRESENT,          // 显示或输出颜色缓冲区
+    PROFILE_STAGE_COUNT
+} profile_stage_t;
+
+typedef enum {
+    PROFILE_COUNTER_TRIANGLES_IN,       // 提交的三角形
+    PROFILE_COUNTER_INSTANCES_CULLED,   // 包围球完全在视锥外的实例
+    PROFILE_COUNTER_TRIANGLES_CLIPPED,  // 被裁剪平面切分或丢弃的三角形
+    PROFILE_COUNTER_TRIANGLES_CULLED,   // 背面剔除的三角形
+    PROFILE_COUNTER_FRAGMENTS_TESTED,   // 三角形覆盖的像素
+    PROFILE_COUNTER_DEPTH_FAILED,       // 未通过深度测试的像素
+    PROFILE_COUNTER_HIZ_TILES_REJECTED, // 层次深度整图块剔除的三角形（每个图块计一次）
+    PROFILE_COUNTER_HIZ_BLOCKS_REJECTED,// 层次深度剔除的8x8像素块
+    PROFILE_COUNTER_RAYS_PRIMARY,
+    PROFILE_COUNTER_RAYS_REFLECTION,
+    PROFILE_COUNTER_RAYS_SHADOW,
+    PROFILE_COUNTER_COUNT
+} profile_counter_t;
+
+// 一帧的汇总结果
+typedef struct {
+    uint64_t index;
+    double frame_ms;
+    double stage_ms[PROFILE_STAGE_COUNT];       // 各阶段耗时之和（多线程阶段为各线程之和）
+    uint32_t stage_calls[PROFILE_STAGE_COUNT];
+    uint64_t counters[PROFILE_COUNTER_COUNT];
+    uint32_t dropped_events;                    // 事件缓冲区已满而未记录的计时事件
+} profile_frame_t;
+
+const char* profile_stage_name(profile_stage_t stage);
+const char* profile_counter_name(profile_counter_t counter);
+
+// 最近一次完整帧的结果，未启用或尚无数据时返回false
+bool profile_last_frame(profile_frame_t* out);
+
+// 输出最近一帧的统计（JSON）或计时事件（Chrome trace格式，可在chrome://tracing或Perfetto中查看）
+bool profile_write_json(FILE* file);
+bool profile_write_chrome_trace(FILE* file);
+
+#ifdef TINY_RENDERER_PROFILE
+
+#include "timing.h"
+
+// 每个线程每帧最多记录的计时事件数
+#define PROFILE_MAX_EVENTS 4096
+
+typedef struct {
+    int stage;
+    double start_ms;
+    double end_ms;
+} profile_event_t;
+
+// 线程局部的计数和计时数据，只由所属线程写入，帧开始/结束时由主线程读取和清零
+typedef struct profile_thread {
+    uint64_t counters[PROFILE_COUNTER_COUNT];
+    double stage_ms[PROFILE_STAGE_COUNT];
+    uint32_t stage_calls[PROFILE_STAGE_COUNT];
+    profile_event_t events[PROFILE_MAX_EVENTS];
+    uint32_t event_count;
+    uint32_t dropped_events;
+    int id;
+    struct profile_thread* next;
+} profile_thread_t;
+
+// 每个线程第一次使用时登记自己的数据块
+extern _Thread_local profile_thread_t* profile_self;
+profile_thread_t* profile_register_thread(void);
+
+void profile_frame_begin(void);
+void profile_frame_end(void);
+void profile_record(profile_thread_t* thread, profile_stage_t stage, double start_ms, double end_ms);
+
+static inline profile_thread_t* profile_thread(void) {
+    return profile_self ? profile_self : profile_register_thread();
+}
+
+#define PROFILE_FRAME_BEGIN() profile_frame_begin()
+#define PROFILE_FRAME_END() profile_frame_end()
+#define PROFILE_BEGIN(stage) double profile_start_##stage = time_now_ms()
+#define PROFILE_END(stage) profile_record(profile_thread(), stage, profile_start_##stage, time_now_ms())
+#define PROFILE_COUNT(counter, n) (profile_thread()->counters[counter] += (uint64_t)(n))
+
+#else
+
+#define PROFILE_FRAME_BEGIN() ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+#define PROFILE_BEGIN(stage) ((void)0)
+#define PROFILE_END(stage) ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)0)
+
+#endif
+
+#endif // PROFILE_H
@@ -1,9 +1,19 @@
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+#include <stdint.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 #include "raster.h"
 #include "display.h"
 #include "geometry.h"
-#include "matrix.h"
+#include "aabb.h"
+#include "mat4.h"
+#include "profile.h"
+#include "thread_pool.h"
+#include "arena.h"
+#include "simd.h"
 
 // 辅助插值函数
 void interpolate(int i0, int d0, int i1, int d1, int* out, int* out_len) {
@@ -35,30 +45,117 @@ void interpolate_float(int i0, float d0, int i1, float d1, float* out, int* out_
 }
 
 
-void draw_line(vec2_t p0, vec2_t p1, uint32_t color)
-{
-    int dx = p1.x - p0.x;
-    int dy = p1.y - p0.y;
-    if (abs(dx) > abs(dy)) {
-        // 横向主线
-        if (dx < 0) { vec2_t tmp = p0; p0 = p1; p1 = tmp; dx = -dx; dy = -dy; }
-        int len;
-        int ys[2048]; // 假设线段不会超过2048像素
-        interpolate(p0.x, p0.y, p1.x, p1.y, ys, &len);
-        for (int x = p0.x, i = 0; x <= p1.x && i < len; ++x, ++i) {
-            draw_pixel(x, ys[i], color);
+#pragma region 画线
+
+// 线段端点坐标的范围，超出时先按参数方程裁剪到该范围内，保证下面的整数运算不溢出
+#define LINE_COORD_LIMIT 16777216.0f
+
+static int64_t floor_div64(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    if (a % b != 0 && (a < 0) != (b < 0)) q--;
+    return q;
+}
+
+static int64_t ceil_div64(int64_t a, int64_t b) {
+    return -floor_div64(-a, b);
+}
+
+// Liang-Barsky：把线段裁剪到[-LINE_COORD_LIMIT, LINE_COORD_LIMIT]的正方形内，z随之插值
+static bool clip_line_to_limit(vec2_t* p0, float* z0, vec2_t* p1, float* z1) {
+    float dx = p1->x - p0->x, dy = p1->y - p0->y;
+    float p[4] = {-dx, dx, -dy, dy};
+    float q[4] = {p0->x + LINE_COORD_LIMIT, LINE_COORD_LIMIT - p0->x, p0->y + LINE_COORD_LIMIT, LINE_COORD_LIMIT - p0->y};
+    float t0 = 0.0f, t1 = 1.0f;
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0.0f) {
+            if (q[i] < 0.0f) return false;
+            continue;
         }
+        float t = q[i] / p[i];
+        if (p[i] < 0.0f) { if (t > t0) t0 = t; }
+        else if (t < t1) t1 = t;
+    }
+    if (t0 > t1) return false;
+    vec2_t a = *p0;
+    float za = *z0, dz = *z1 - *z0;
+    *p0 = (vec2_t){a.x + dx * t0, a.y + dy * t0};
+    *p1 = (vec2_t){a.x + dx * t1, a.y + dy * t1};
+    *z0 = za + dz * t0;
+    *z1 = za + dz * t1;
+    return true;
+}
+
+// 画布坐标（原点在中心，y向上）的线段，只写入屏幕像素矩形[rx0, rx1] x [ry0, ry1]内的部分
+// 端点坐标取整后沿主轴逐像素前进，第k个像素的副轴坐标为 d0 + (d1 - d0) * k / n 四舍五入，
+// 用Bresenham误差项递推；先按矩形解出k的范围，不在范围外的像素上循环，也不需要临时数组
+// depth不为NULL时z在端点之间线性插值，只写入不比depth中已有值更远的像素（不更新深度）
+static void raster_line(vec2_t p0, float z0, vec2_t p1, float z1, uint32_t color,
+                        const float* depth, int rx0, int ry0, int rx1, int ry1) {
+    if (!isfinite(p0.x) || !isfinite(p0.y) || !isfinite(p1.x) || !isfinite(p1.y)) return;
+    if (fabsf(p0.x) > LINE_COORD_LIMIT || fabsf(p0.y) > LINE_COORD_LIMIT ||
+        fabsf(p1.x) > LINE_COORD_LIMIT || fabsf(p1.y) > LINE_COORD_LIMIT) {
+        if (!clip_line_to_limit(&p0, &z0, &p1, &z1)) return;
+    }
+    int cx = window_width / 2, cy = window_height / 2;
+    int x0 = (int)p0.x, y0 = (int)p0.y, x1 = (int)p1.x, y1 = (int)p1.y;
+    bool x_major = abs(x1 - x0) > abs(y1 - y0);
+    // 主轴坐标i从i0递增到i1，副轴坐标为d
+    int i0 = x_major ? x0 : y0, i1 = x_major ? x1 : y1;
+    int d0 = x_major ? y0 : x0, d1 = x_major ? y1 : x1;
+    if (i1 < i0) {
+        int ti = i0; i0 = i1; i1 = ti;
+        int td = d0; d0 = d1; d1 = td;
+        float tz = z0; z0 = z1; z1 = tz;
+    }
+    // 矩形在画布坐标下的主轴和副轴范围（画布坐标的y与屏幕方向相反）
+    int lo = x_major ? rx0 - cx : cy - ry1, hi = x_major ? rx1 - cx : cy - ry0;
+    int mlo = x_major ? cy - ry1 : rx0 - cx, mhi = x_major ? cy - ry0 : rx1 - cx;
+    int64_t n = i1 - i0, dd = d1 - d0;
+    int64_t kmin = lo - i0 > 0 ? lo - i0 : 0;
+    int64_t kmax = hi - i0 < n ? hi - i0 : n;
+    if (n == 0) {
+        if (d0 < mlo || d0 > mhi) return;
+    } else if (dd == 0) {
+        if (d0 < mlo || d0 > mhi) return;
     } else {
-        // 纵向主线
-        if (dy < 0) { vec2_t tmp = p0; p0 = p1; p1 = tmp; dx = -dx; dy = -dy; }
-        int len;
-        int xs[2048];
-        interpolate(p0.y, p0.x, p1.y, p1.x, xs, &len);
-        for (int y = p0.y, i = 0; y <= p1.y && i < len; ++y, ++i) {
-            draw_pixel(xs[i], y, color);
-        }
+        // d(k) = d0 + floor((2 * dd * k + n) / (2n))，解出mlo <= d(k) <= mhi对应的k
+        int64_t a = 2 * n * (mlo - d0) - n;
+        int64_t b = 2 * n * (mhi - d0 + 1) - n - 1;
+        int64_t lo_k = dd > 0 ? ceil_div64(a, 2 * dd) : ceil_div64(b, 2 * dd);
+        int64_t hi_k = dd > 0 ? floor_div64(b, 2 * dd) : floor_div64(a, 2 * dd);
+        if (lo_k > kmin) kmin = lo_k;
+        if (hi_k < kmax) kmax = hi_k;
     }
-} 
+    if (kmin > kmax) return;
+
+    // 误差项r在[0, 2n)内，每前进一个像素加2 * dd，越界时副轴走一步
+    int64_t two_n = n > 0 ? 2 * n : 1;
+    int64_t num = 2 * dd * kmin + n;
+    int64_t q = floor_div64(num, two_n);
+    int64_t r = num - q * two_n;
+    int d = d0 + (int)q;
+    int i = i0 + (int)kmin;
+    int sx = cx + (x_major ? i : d), sy = cy - (x_major ? d : i);
+    ptrdiff_t index = (ptrdiff_t)window_width * sy + sx;
+    ptrdiff_t major_step = x_major ? 1 : -window_width;
+    ptrdiff_t minor_step = x_major ? -window_width : 1;
+    float dz = n > 0 ? (z1 - z0) / (float)n : 0.0f;
+    float z = z0 + dz * (float)kmin;
+    for (int64_t k = kmin; k <= kmax; k++) {
+        if (!depth || z >= depth[index]) color_buffer[index] = color;
+        r += 2 * dd;
+        if (r >= two_n) { r -= two_n; index += minor_step; }
+        else if (r < 0) { r += two_n; index -= minor_step; }
+        index += major_step;
+        z += dz;
+    }
+}
+
+void draw_line(vec2_t p0, vec2_t p1, uint32_t color) {
+    raster_line(p0, 0.0f, p1, 0.0f, color, NULL, 0, 0, window_width - 1, window_height - 1);
+}
+
+#pragma endregion
 
 void draw_wireframe_triangle(vec2_t p0, vec2_t p1, vec2_t p2, uint32_t color) {
     draw_line(p0, p1, color);
@@ -104,13 +201,12 @@ void draw_filled_triangle(vec2_t p0, vec2_t p1, vec2_t p2, uint32_t color) {
         x_right = x02;
     }
 
-    // 绘制水平线段
+    // 绘制水平线段（画布坐标转为屏幕坐标后整段写入）
+    int cx = window_width / 2, cy = window_height / 2;
     for (int y = p0.y; y <= p2.y; y++) {
         int idx = y - p0.y;
         if (idx < x02_len && idx < x012_len) {
-            for (int x = x_left[idx]; x <= x_right[idx]; x++) {
-                draw_pixel(x, y, color);
-            }
+            draw_span(cy - y, cx + x_left[idx], cx + x_right[idx], color);
         }
     }
 }
@@ -171,9 +267,16 @@ void draw_shaded_triangle(
         x_right = x02; h_right = h02;
     }
 
-    // 绘制水平线段
+    // 绘制水平线段：每行只裁剪一次，通过行指针写入
+    int cx = window_width / 2, cy = window_height / 2;
+    uint8_t a = (color >> 24) & 0xFF;
+    uint8_t r = (color >> 16) & 0xFF;
+    uint8_t g = (color >> 8) & 0xFF;
+    uint8_t b = color & 0xFF;
     for (int y = y0; y <= y2; y++) {
         int idx = y - y0;
+        int sy = cy - y;
+        if (sy < 0 || sy >= window_height) continue;
         if (idx < x02_len && idx < x012_len) {
             int xl = x_left[idx];
             int xr = x_right[idx];
@@ -183,20 +286,20 @@ void draw_shaded_triangle(
             if (seg_len <= 0) continue;
             float hstep = (hr - hl) / (float)(xr - xl == 0 ? 1 : xr - xl);
             float hval = hl;
-            for (int x = xl; x <= xr; x++) {
+            // 左侧画布外的像素只累加亮度，保持与逐像素绘制相同的插值结果
+            int x_begin = -cx > xl ? -cx : xl;
+            int x_end = window_width - 1 - cx < xr ? window_width - 1 - cx : xr;
+            for (int x = xl; x < x_begin; x++) hval += hstep;
+            uint32_t* row = color_buffer + (size_t)window_width * sy + cx;
+            for (int x = x_begin; x <= x_end; x++) {
                 // 计算插值后的颜色
                 float shade = hval;
                 if (shade < 0.0f) shade = 0.0f;
                 if (shade > 1.0f) shade = 1.0f;
-                uint8_t a = (color >> 24) & 0xFF;
-                uint8_t r = (color >> 16) & 0xFF;
-                uint8_t g = (color >> 8) & 0xFF;
-                uint8_t b = color & 0xFF;
                 uint8_t rr = (uint8_t)(r * shade);
                 uint8_t gg = (uint8_t)(g * shade);
                 uint8_t bb = (uint8_t)(b * shade);
-                uint32_t shaded_color = (a << 24) | (rr << 16) | (gg << 8) | bb;
-                draw_pixel(x, y, shaded_color);
+                row[x] = ((uint32_t)a << 24) | (rr << 16) | (gg << 8) | bb;
                 hval += hstep;
             }
         }
@@ -219,119 +322,431 @@ vec2_t project_vertex(vec3_t v, int canvas_width, int canvas_height, float viewp
     return view_port_to_canvas(projected, canvas_width, canvas_height, viewport_size);
 }
 
-// 裁剪三角形，输出到triangles_out，返回新三角形数量
-static int clip_triangle(
-    triangle_t tri,
-    plane_t plane,
-    vec3_t* vertexes,
-    triangle_t* triangles_out,
-    vec3_t* new_vertexes,
-    int* new_vertex_count,
-    int max_vertex
-) {
-    int idx[3] = {tri.v0, tri.v1, tri.v2};
-    float d[3];
-    int in_idx[3], out_idx[3], in_count = 0, out_count = 0;
-    for (int i = 0; i < 3; i++) {
-        d[i] = vec3_dot(plane.normal, vertexes[idx[i]]) + plane.distance;
-        if (d[i] > 0) in_idx[in_count++] = i;
-        else out_idx[out_count++] = i;
-    }
-    if (in_count == 0) return 0;
-    if (in_count == 3) {
-        triangles_out[0] = tri;
-        return 1;
-    }
-    if (in_count == 1 && out_count == 2) {
-        int i0 = in_idx[0], i1 = out_idx[0], i2 = out_idx[1];
-        int v0 = idx[i0], v1 = idx[i1], v2 = idx[i2];
-        float t1 = d[i0] / (d[i0] - d[i1]);
-        float t2 = d[i0] / (d[i0] - d[i2]);
-        if (*new_vertex_count + 2 >= max_vertex) return 0; // 防止越界
-        vec3_t p1 = vec3_add(vertexes[v0], vec3_scale(vec3_sub(vertexes[v1], vertexes[v0]), t1));
-        vec3_t p2 = vec3_add(vertexes[v0], vec3_scale(vec3_sub(vertexes[v2], vertexes[v0]), t2));
-        int p1_idx = (*new_vertex_count)++;
-        int p2_idx = (*new_vertex_count)++;
-        new_vertexes[p1_idx] = p1;
-        new_vertexes[p2_idx] = p2;
-        triangles_out[0] = (triangle_t){v0, p1_idx, p2_idx, tri.color};
-        return 1;
-    }
-    if (in_count == 2 && out_count == 1) {
-        int i0 = in_idx[0], i1 = in_idx[1], i2 = out_idx[0];
-        int v0 = idx[i0], v1 = idx[i1], v2 = idx[i2];
-        float t0 = d[i0] / (d[i0] - d[i2]);
-        float t1 = d[i1] / (d[i1] - d[i2]);
-        if (*new_vertex_count + 2 >= max_vertex) return 0; // 防止越界
-        vec3_t p0 = vec3_add(vertexes[v0], vec3_scale(vec3_sub(vertexes[v2], vertexes[v0]), t0));
-        vec3_t p1 = vec3_add(vertexes[v1], vec3_scale(vec3_sub(vertexes[v2], vertexes[v1]), t1));
-        int p0_idx = (*new_vertex_count)++;
-        int p1_idx = (*new_vertex_count)++;
-        new_vertexes[p0_idx] = p0;
-        new_vertexes[p1_idx] = p1;
-        triangles_out[0] = (triangle_t){v0, v1, p0_idx, tri.color};
-        triangles_out[1] = (triangle_t){v1, p1_idx, p0_idx, tri.color};
-        return 2;
-    }
-    return 0;
-}
-
-// 变换和裁剪模型
-model_t* transform_and_clip(
-    plane_t* planes, int plane_count,
-    model_t* model, matrix_t* transform
-) {
-    // 1. 变换所有顶点
-    int max_vertex = model->vertex_count + model->triangle_count * 256; // 放大，防止越界
-    vec3_t* vertexes = malloc(sizeof(vec3_t) * max_vertex);
-    for (int i = 0; i < model->vertex_count; i++) {
-        // 只取前三维
-        vec4_t v4 = {model->vertexes[i].x, model->vertexes[i].y, model->vertexes[i].z, 1.0f};
-        vec4_t tv = matrix_mul_vec4(*transform, v4);
-        vertexes[i] = (vec3_t){tv.x, tv.y, tv.z};
+// 顶点编码（outcode）：第p位为1表示顶点在第p个平面外侧（有向距离 <= 0）
+// 三角形三个顶点编码的与不为0时整体在某个平面外侧，直接丢弃；
+// 或在需要几何裁剪的平面上为0时整体在内侧，原样保留；只有其余三角形需要裁剪
+#define CLIP_MAX_PLANES 32
+// 凸多边形每经过一个平面最多增加一个顶点
+#define CLIP_MAX_POLYGON (3 + CLIP_MAX_PLANES)
+
+// 保护带：侧面不做几何裁剪，超出屏幕的部分由光栅化的包围盒裁剪处理
+// 范围（距屏幕中心的像素数）受光栅化定点数精度限制，超出保护带的三角形仍按保护带平面裁剪
+#define GUARD_BAND_PIXELS 16384
+
+// 裁剪多边形的顶点：index为顶点在模型中的下标（-1为裁剪产生的新顶点），
+// weight为顶点在原三角形三个顶点上的重心坐标，用于插值顶点属性
+typedef struct {
+    vec3_t position;
+    vec3_t weight;
+    int index;
+} clip_vertex_t;
+
+// Sutherland-Hodgman：用一个平面裁剪凸多边形
+static int clip_polygon(const clip_vertex_t* in, int n, plane_t plane, clip_vertex_t* out) {
+    int count = 0;
+    float d_prev = vec3_dot(plane.normal, in[n - 1].position) + plane.distance;
+    for (int i = 0, prev = n - 1; i < n; prev = i, i++) {
+        float d = vec3_dot(plane.normal, in[i].position) + plane.distance;
+        if ((d > 0) != (d_prev > 0)) {
+            // 边跨过平面，从内侧的端点向外插值，保证同一条边两侧得到相同的交点
+            const clip_vertex_t* a = d_prev > 0 ? &in[prev] : &in[i];
+            const clip_vertex_t* b = d_prev > 0 ? &in[i] : &in[prev];
+            float da = d_prev > 0 ? d_prev : d, db = d_prev > 0 ? d : d_prev;
+            float s = da / (da - db);
+            out[count].position = vec3_add(a->position, vec3_scale(vec3_sub(b->position, a->position), s));
+            out[count].weight = vec3_add(a->weight, vec3_scale(vec3_sub(b->weight, a->weight), s));
+            out[count++].index = -1;
+        }
+        if (d > 0) out[count++] = in[i];
+        d_prev = d;
+    }
+    return count;
+}
+
+// 屏幕坐标转为28.4定点数，供半空间光栅化使用
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+// 转为整数前的截断范围，只需保证转换不溢出：保护带平面总是做几何裁剪，
+// 被光栅化使用的顶点都在保护带内（坐标差不超过2^19，边函数的系数和乘积不超出int32），近平面外（z <= 0）的顶点不会被使用
+#define PROJECT_LIMIT 1073741824.0f
+
+// 投影后的顶点：每个顶点（包括裁剪产生的顶点）只投影一次，三角形按下标引用
+typedef struct {
+    int32_t x, y;       // 定点屏幕坐标：sx = w/2 + x, sy = h/2 - y，乘以SUBPIXEL_ONE
+    float iz;           // 1/z
+    int32_t ox, oy;     // 描边端点，与project_vertex的结果相同，只在开启描边时计算
+} projected_vertex_t;
+
+// 变换和裁剪后的模型：顶点在相机空间，裁剪产生的顶点追加在末尾，数据分配在帧arena上
+typedef struct {
+    vec3_t* vertexes;
+    projected_vertex_t* projected;  // 与vertexes一一对应
+    int vertex_count;
+    const triangle_t* triangles;
+    int triangle_count;
+    // 顶点属性的来源：原模型的顶点属性和三角形，以及相机空间的法向量变换
+    const model_t* source;
+    const int* source_triangles;    // 每个三角形对应的原三角形下标，NULL表示与原模型一一对应
+    const vec3_t* clip_weights;     // 裁剪产生的顶点（下标 >= source->vertex_count）在原三角形上的重心坐标
+    mat3_t normal_matrix;
+    // 逐顶点光照时原模型每个顶点的光照强度，模型没有顶点法向量时为NULL（按面法向量计算）
+    const float* light;
+} transformed_model_t;
+
+static inline float clamp_projected(float v) {
+    return v > PROJECT_LIMIT ? PROJECT_LIMIT : (v > -PROJECT_LIMIT ? v : -PROJECT_LIMIT);
+}
+
+// 与project_vertex相同的投影，但保留亚像素精度；transform_batch是它的SIMD版本，结果逐位一致
+static void project_one(vec3_t v, bool outline, projected_vertex_t* out) {
+    float viewport_size = 1.0f;
+    float projection_plane_z = 1.0f;
+    float inv_z = 1.0f / v.z;
+    float k = inv_z * projection_plane_z;
+    float sx = window_width * 0.5f + v.x * k * (window_width / viewport_size);
+    float sy = window_height * 0.5f - v.y * k * (window_height / viewport_size);
+    out->x = (int32_t)lrintf(clamp_projected(sx * SUBPIXEL_ONE));
+    out->y = (int32_t)lrintf(clamp_projected(sy * SUBPIXEL_ONE));
+    out->iz = inv_z;
+    if (outline) {
+        // 与project_vertex的运算顺序相同
+        float px = v.x * projection_plane_z / v.z;
+        float py = v.y * projection_plane_z / v.z;
+        out->ox = (int32_t)clamp_projected(px * window_width / viewport_size);
+        out->oy = (int32_t)clamp_projected(py * window_height / viewport_size);
     }
+}
+
+// 批量变换：从模型的SoA副本读取顶点，一次得到相机空间位置和投影结果
+// lighting不为NULL时同时变换法向量，并按SIMD批量计算每个顶点的光照强度
+typedef struct {
+    const vertex_soa_t* soa;
+    const mat4_t* transform;
+    vec3_t* vertexes;
+    projected_vertex_t* projected;
+    int vertex_count;
+    bool outline;
+    const lighting_t* lighting;
+    const mat3_t* normal_matrix;
+    float* light;
+} transform_job_t;
+
+// 每个并行任务处理的顶点数（SIMD宽度的整数倍），顶点数不到4个任务时不拆分
+#define TRANSFORM_BATCH 8192
+
+static void transform_batch(const transform_job_t* job, int begin, int end) {
+    float viewport_size = 1.0f;
+    float projection_plane_z = 1.0f;
+    const float (*m)[4] = job->transform->m;
+    simd_float m00 = simd_set1(m[0][0]), m01 = simd_set1(m[0][1]), m02 = simd_set1(m[0][2]), m03 = simd_set1(m[0][3]);
+    simd_float m10 = simd_set1(m[1][0]), m11 = simd_set1(m[1][1]), m12 = simd_set1(m[1][2]), m13 = simd_set1(m[1][3]);
+    simd_float m20 = simd_set1(m[2][0]), m21 = simd_set1(m[2][1]), m22 = simd_set1(m[2][2]), m23 = simd_set1(m[2][3]);
+    simd_float one = simd_set1(1.0f), plane_z = simd_set1(projection_plane_z);
+    simd_float half_w = simd_set1(window_width * 0.5f), half_h = simd_set1(window_height * 0.5f);
+    simd_float scale_x = simd_set1(window_width / viewport_size), scale_y = simd_set1(window_height / viewport_size);
+    simd_float width = simd_set1((float)window_width), height = simd_set1((float)window_height);
+    simd_float size = simd_set1(viewport_size), subpixel = simd_set1((float)SUBPIXEL_ONE);
+    simd_float lo = simd_set1(-PROJECT_LIMIT), hi = simd_set1(PROJECT_LIMIT);
+    _Alignas(SIMD_ALIGN) float cx[SIMD_WIDTH], cy[SIMD_WIDTH], cz[SIMD_WIDTH];
+    _Alignas(SIMD_ALIGN) float fx[SIMD_WIDTH], fy[SIMD_WIDTH], fz[SIMD_WIDTH];
+    _Alignas(SIMD_ALIGN) float ox[SIMD_WIDTH], oy[SIMD_WIDTH];
+    _Alignas(SIMD_ALIGN) float nx[SIMD_WIDTH], ny[SIMD_WIDTH], nz[SIMD_WIDTH], light[SIMD_WIDTH];
+    const mat3_t* nm = job->normal_matrix;
+    const vertex_soa_t* soa = job->soa;
+    for (int i = begin; i < end; i += SIMD_WIDTH) {
+        simd_float x = simd_load(soa->x + i), y = simd_load(soa->y + i), z = simd_load(soa->z + i);
+        // 求和顺序与mat4_mul_vec4(w = 1)相同
+        simd_float tx = simd_add(simd_add(simd_add(simd_mul(m00, x), simd_mul(m01, y)), simd_mul(m02, z)), m03);
+        simd_float ty = simd_add(simd_add(simd_add(simd_mul(m10, x), simd_mul(m11, y)), simd_mul(m12, z)), m13);
+        simd_float tz = simd_add(simd_add(simd_add(simd_mul(m20, x), simd_mul(m21, y)), simd_mul(m22, z)), m23);
+        simd_float iz = simd_div(one, tz);
+        simd_float k = simd_mul(iz, plane_z);
+        simd_float sx = simd_add(half_w, simd_mul(simd_mul(tx, k), scale_x));
+        simd_float sy = simd_sub(half_h, simd_mul(simd_mul(ty, k), scale_y));
+        simd_store(fx, simd_max(simd_min(simd_mul(sx, subpixel), hi), lo));
+        simd_store(fy, simd_max(simd_min(simd_mul(sy, subpixel), hi), lo));
+        simd_store(fz, iz);
+        simd_store(cx, tx);
+        simd_store(cy, ty);
+        simd_store(cz, tz);
+        if (job->outline) {
+            // 与project_vertex的运算顺序相同
+            simd_float px = simd_div(simd_mul(simd_div(simd_mul(tx, plane_z), tz), width), size);
+            simd_float py = simd_div(simd_mul(simd_div(simd_mul(ty, plane_z), tz), height), size);
+            simd_store(ox, simd_max(simd_min(px, hi), lo));
+            simd_store(oy, simd_max(simd_min(py, hi), lo));
+        }
+        if (job->lighting) {
+            // 求和顺序与mat3_mul_vec3相同
+            simd_float mx = simd_load(soa->nx + i), my = simd_load(soa->ny + i), mz = simd_load(soa->nz + i);
+            float* rows[3] = {nx, ny, nz};
+            for (int r = 0; r < 3; r++) {
+                simd_float n = simd_add(simd_add(simd_mul(simd_set1(nm->m[r][0]), mx),
+                                                 simd_mul(simd_set1(nm->m[r][1]), my)),
+                                        simd_mul(simd_set1(nm->m[r][2]), mz));
+                simd_store(rows[r], n);
+            }
+            lighting_intensity_batch(job->lighting, cx, cy, cz, nx, ny, nz, light, SIMD_WIDTH);
+        }
+        // 整数转换和AoS输出逐个顶点进行，三角形设置按下标随机访问
+        int lanes = job->vertex_count - i < SIMD_WIDTH ? job->vertex_count - i : SIMD_WIDTH;
+        for (int lane = 0; lane < lanes; lane++) {
+            projected_vertex_t* p = &job->projected[i + lane];
+            job->vertexes[i + lane] = (vec3_t){cx[lane], cy[lane], cz[lane]};
+            p->x = (int32_t)lrintf(fx[lane]);
+            p->y = (int32_t)lrintf(fy[lane]);
+            p->iz = fz[lane];
+            if (job->outline) {
+                p->ox = (int32_t)ox[lane];
+                p->oy = (int32_t)oy[lane];
+            }
+            if (job->lighting) job->light[i + lane] = light[lane];
+        }
+    }
+}
+
+static void transform_task(void* ctx, int task_index, int worker_index) {
+    (void)worker_index;
+    const transform_job_t* job = ctx;
+    int begin = task_index * TRANSFORM_BATCH;
+    int end = begin + TRANSFORM_BATCH;
+    if (end > job->soa->padded_count) end = job->soa->padded_count;
+    transform_batch(job, begin, end);
+}
+
+// 变换并投影所有顶点，没有SoA副本的模型逐个顶点变换
+// lighting不为NULL且模型有顶点法向量时，同时计算每个顶点的光照强度（out->light）
+static bool transform_vertexes(arena_t* arena, thread_pool_t* pool, const model_t* model,
+                               const mat4_t* transform, bool outline, const lighting_t* lighting,
+                               transformed_model_t* out) {
     int vertex_count = model->vertex_count;
+    out->vertexes = arena_alloc(arena, sizeof(vec3_t) * vertex_count);
+    out->projected = arena_alloc(arena, sizeof(projected_vertex_t) * vertex_count);
+    if (!out->vertexes || !out->projected) return false;
+    out->vertex_count = vertex_count;
+    // 实例只有均匀缩放，法向量用变换的3x3部分即可，着色时再归一化
+    out->normal_matrix = mat3_from_mat4(transform);
+    out->light = NULL;
+    if (!model->normals) lighting = NULL;
+    float* light = NULL;
+    if (lighting) {
+        light = arena_alloc(arena, sizeof(float) * vertex_count);
+        if (!light) return false;
+        out->light = light;
+    }
 
-    // 2. 裁剪三角形
-    int max_tri = model->triangle_count * 32; // 放大
-    triangle_t* triangles = malloc(sizeof(triangle_t) * max_tri);
-    memcpy(triangles, model->triangles, sizeof(triangle_t) * model->triangle_count);
+    if (!model->soa.x || model->soa.padded_count < vertex_count || (lighting && !model->soa.nx)) {
+        for (int i = 0; i < vertex_count; i++) {
+            // 只取前三维
+            vec4_t v4 = {model->vertexes[i].x, model->vertexes[i].y, model->vertexes[i].z, 1.0f};
+            vec4_t tv = mat4_mul_vec4(transform, v4);
+            out->vertexes[i] = (vec3_t){tv.x, tv.y, tv.z};
+            project_one(out->vertexes[i], outline, &out->projected[i]);
+            if (lighting) {
+                vec3_t normal = mat3_mul_vec3(&out->normal_matrix, model->normals[i]);
+                light[i] = lighting_intensity(lighting, out->vertexes[i], normal);
+            }
+        }
+        return true;
+    }
+
+    transform_job_t job = {
+        &model->soa, transform, out->vertexes, out->projected, vertex_count, outline,
+        lighting, &out->normal_matrix, light
+    };
+    int padded = model->soa.padded_count;
+    int tasks = (padded + TRANSFORM_BATCH - 1) / TRANSFORM_BATCH;
+    if (pool && tasks >= 4) {
+        thread_pool_run(pool, tasks, transform_task, &job);
+    } else {
+        transform_batch(&job, 0, padded);
+    }
+    return true;
+}
+
+// 变换和裁剪模型，结果分配在arena上，arena下次reset前有效
+// active_mask为需要检查的平面（与包围球相交），clip_mask为其中需要几何裁剪的平面
+// lighting不为NULL时（逐顶点光照）同时计算顶点的光照强度
+static transformed_model_t* transform_and_clip(
+    arena_t* arena, thread_pool_t* pool, bool outline, const lighting_t* lighting,
+    const plane_t* planes, int plane_count, uint32_t active_mask, uint32_t clip_mask,
+    const model_t* model, const mat4_t* transform
+) {
+    // 1. 变换并投影所有顶点
+    PROFILE_BEGIN(PROFILE_STAGE_TRANSFORM);
+    transformed_model_t* result = arena_alloc(arena, sizeof(transformed_model_t));
+    bool ok = result && transform_vertexes(arena, pool, model, transform, outline, lighting, result);
+    PROFILE_END(PROFILE_STAGE_TRANSFORM);
+    if (!ok) return NULL;
+
+    vec3_t* vertexes = result->vertexes;
+    int vertex_count = result->vertex_count;
+    result->triangles = model->triangles;
+    result->triangle_count = model->triangle_count;
+    result->source = model;
+    result->source_triangles = NULL;
+    result->clip_weights = NULL;
+    // 包围球完全在所有平面内侧，不需要任何裁剪，直接使用原模型的三角形数组（只读）
+    if (active_mask == 0) return result;
+
+    // 2. 每个顶点计算一次编码
+    PROFILE_BEGIN(PROFILE_STAGE_CLIP);
+    uint32_t* outcodes = arena_alloc(arena, sizeof(uint32_t) * vertex_count);
+    if (!outcodes) return NULL;
+    for (int v = 0; v < vertex_count; v++) {
+        uint32_t code = 0;
+        for (int p = 0; p < plane_count; p++) {
+            if (!(active_mask >> p & 1)) continue;
+            if (!(vec3_dot(planes[p].normal, vertexes[v]) + planes[p].distance > 0)) code |= 1u << p;
+        }
+        outcodes[v] = code;
+    }
+
+    // 3. 统计保留、丢弃和需要裁剪的三角形，按最坏情况为裁剪输出预留空间
+    const triangle_t* triangles = model->triangles;
     int triangle_count = model->triangle_count;
+    int max_triangles = 0, max_new_vertexes = 0;
+    bool all_inside = true;
+    for (int t = 0; t < triangle_count; t++) {
+        uint32_t c0 = outcodes[triangles[t].v0], c1 = outcodes[triangles[t].v1], c2 = outcodes[triangles[t].v2];
+        if (c0 & c1 & c2) { all_inside = false; continue; }
+        uint32_t crossing = (c0 | c1 | c2) & clip_mask;
+        if (crossing) {
+            // n个平面裁剪后最多3 + n个顶点，扇形分成1 + n个三角形，新增顶点不超过2n个
+            int n = 0;
+            for (uint32_t mask = crossing; mask; mask &= mask - 1) n++;
+            max_triangles += 1 + n;
+            max_new_vertexes += 2 * n;
+            all_inside = false;
+        } else {
+            max_triangles++;
+        }
+    }
+    if (all_inside) {
+        PROFILE_END(PROFILE_STAGE_CLIP);
+        return result;
+    }
 
-    for (int p = 0; p < plane_count; p++) {
-        triangle_t* new_tris = malloc(sizeof(triangle_t) * max_tri);
-        int new_count = 0;
-        for (int t = 0; t < triangle_count; t++) {
-            new_count += clip_triangle(triangles[t], planes[p], vertexes, &new_tris[new_count], vertexes, &vertex_count, max_vertex);
+    triangle_t* out = arena_alloc(arena, sizeof(triangle_t) * max_triangles);
+    int* out_source = arena_alloc(arena, sizeof(int) * max_triangles);
+    if (!out || !out_source) return NULL;
+    projected_vertex_t* projected = result->projected;
+    vec3_t* clip_weights = NULL;
+    if (max_new_vertexes > 0) {
+        int capacity = vertex_count + max_new_vertexes;
+        vec3_t* grown = arena_alloc(arena, sizeof(vec3_t) * capacity);
+        projected_vertex_t* grown_projected = arena_alloc(arena, sizeof(projected_vertex_t) * capacity);
+        clip_weights = arena_alloc(arena, sizeof(vec3_t) * max_new_vertexes);
+        if (!grown || !grown_projected || !clip_weights) return NULL;
+        memcpy(grown, vertexes, sizeof(vec3_t) * vertex_count);
+        memcpy(grown_projected, projected, sizeof(projected_vertex_t) * vertex_count);
+        vertexes = grown;
+        projected = grown_projected;
+    }
+
+    // 4. 逐个三角形判断，只有跨过裁剪平面的三角形才做多边形裁剪
+    int out_count = 0;
+    for (int t = 0; t < triangle_count; t++) {
+        triangle_t tri = triangles[t];
+        uint32_t c0 = outcodes[tri.v0], c1 = outcodes[tri.v1], c2 = outcodes[tri.v2];
+        if (c0 & c1 & c2) {
+            PROFILE_COUNT(PROFILE_COUNTER_TRIANGLES_CLIPPED, 1);
+            continue;
+        }
+        uint32_t crossing = (c0 | c1 | c2) & clip_mask;
+        if (!crossing) {
+            out_source[out_count] = t;
+            out[out_count++] = tri;
+            continue;
+        }
+        PROFILE_COUNT(PROFILE_COUNTER_TRIANGLES_CLIPPED, 1);
+        clip_vertex_t poly[2][CLIP_MAX_POLYGON];
+        int cur = 0, n = 3;
+        poly[0][0] = (clip_vertex_t){vertexes[tri.v0], {1, 0, 0}, tri.v0};
+        poly[0][1] = (clip_vertex_t){vertexes[tri.v1], {0, 1, 0}, tri.v1};
+        poly[0][2] = (clip_vertex_t){vertexes[tri.v2], {0, 0, 1}, tri.v2};
+        for (int p = 0; p < plane_count && n >= 3; p++) {
+            if (!(crossing >> p & 1)) continue;
+            n = clip_polygon(poly[cur], n, planes[p], poly[cur ^ 1]);
+            cur ^= 1;
+        }
+        if (n < 3) continue;
+        for (int i = 0; i < n; i++) {
+            clip_vertex_t* v = &poly[cur][i];
+            if (v->index < 0) {
+                // 裁剪产生的顶点追加在末尾，同样只投影一次
+                v->index = vertex_count;
+                vertexes[vertex_count] = v->position;
+                clip_weights[vertex_count - model->vertex_count] = v->weight;
+                project_one(v->position, outline, &projected[vertex_count]);
+                vertex_count++;
+            }
+        }
+        // 凸多边形按扇形三角化，保持原来的环绕方向
+        for (int i = 1; i + 1 < n; i++) {
+            out_source[out_count] = t;
+            out[out_count++] = (triangle_t){poly[cur][0].index, poly[cur][i].index, poly[cur][i + 1].index, tri.color};
         }
-        free(triangles);
-        triangles = new_tris;
-        triangle_count = new_count;
     }
+    PROFILE_END(PROFILE_STAGE_CLIP);
 
-    model_t* result = malloc(sizeof(model_t));
     result->vertexes = vertexes;
+    result->projected = projected;
     result->vertex_count = vertex_count;
-    result->triangles = triangles;
-    result->triangle_count = triangle_count;
-    result->bounds_center = model->bounds_center;
-    result->bounds_radius = model->bounds_radius;
+    result->triangles = out;
+    result->triangle_count = out_count;
+    result->source_triangles = out_source;
+    result->clip_weights = clip_weights;
     return result;
 }
 
-// 投影并绘制三角形
+// 包围球与平面分类：完全在某个平面外侧时返回false，
+// 否则在*active_mask中返回与包围球相交的平面（完全在内侧的平面不需要检查）
+static bool classify_bounds(const model_t* model, const mat4_t* transform,
+                            const plane_t* planes, int plane_count, uint32_t* active_mask) {
+    vec3_t c = model->bounds_center;
+    vec4_t center = mat4_mul_vec4(transform, (vec4_t){c.x, c.y, c.z, 1.0f});
+    // 变换可能带缩放：半径乘以3x3部分各列长度的最大值
+    float scale_sq = 0.0f;
+    for (int j = 0; j < 3; j++) {
+        float x = transform->m[0][j];
+        float y = transform->m[1][j];
+        float z = transform->m[2][j];
+        float len_sq = x * x + y * y + z * z;
+        if (len_sq > scale_sq) scale_sq = len_sq;
+    }
+    // 略微放大，避免顶点和球心分别变换的舍入误差导致误判
+    float radius = model->bounds_radius * sqrtf(scale_sq) * 1.0001f + 1e-6f;
+    uint32_t mask = 0;
+    for (int p = 0; p < plane_count; p++) {
+        float d = vec3_dot(planes[p].normal, (vec3_t){center.x, center.y, center.z}) + planes[p].distance;
+        if (d < -radius) return false;
+        if (d <= radius) mask |= 1u << p;
+    }
+    *active_mask = mask;
+    return true;
+}
+
+// 线框模式的投影结果，容量按需增长，不随每次调用释放
+static vec2_t* g_wireframe_points = NULL;
+static int g_wireframe_capacity = 0;
+
+// 投影并绘制三角形，每个顶点只投影一次
 void render_wireframe_model(const model_t* model) {
     float viewport_size = 1.0f;
     float projection_plane_z = 1.0f;
+    if (model->vertex_count > g_wireframe_capacity) {
+        vec2_t* points = realloc(g_wireframe_points, sizeof(vec2_t) * model->vertex_count);
+        if (!points) return;
+        g_wireframe_points = points;
+        g_wireframe_capacity = model->vertex_count;
+    }
+    for (int i = 0; i < model->vertex_count; i++) {
+        g_wireframe_points[i] = project_vertex(model->vertexes[i], window_width, window_height, viewport_size, projection_plane_z);
+    }
     for (int i = 0; i < model->triangle_count; i++) {
         triangle_t tri = model->triangles[i];
-        vec3_t v0 = model->vertexes[tri.v0];
-        vec3_t v1 = model->vertexes[tri.v1];
-        vec3_t v2 = model->vertexes[tri.v2];
-        vec2_t p0 = project_vertex(v0, window_width, window_height, viewport_size, projection_plane_z);
-        vec2_t p1 = project_vertex(v1, window_width, window_height, viewport_size, projection_plane_z);
-        vec2_t p2 = project_vertex(v2, window_width, window_height, viewport_size, projection_plane_z);
-        draw_wireframe_triangle(p0, p1, p2, tri.color);
+        draw_wireframe_triangle(g_wireframe_points[tri.v0], g_wireframe_points[tri.v1], g_wireframe_points[tri.v2], tri.color);
     }
 }
 
@@ -358,143 +773,1117 @@ static bool is_backface(vec3_t v0, vec3_t v1, vec3_t v2) {
 static float* depth_buffer = NULL;
 static int depth_buffer_w = 0, depth_buffer_h = 0;
 
-void clear_depth_buffer(int w, int h) {
+// 层次深度：每个8x8像素块中深度（1/z）的最小值和最大值
+// 三角形在块内的1/z都不大于最小值时整块不可见，都大于最大值时整块可见
+static float* hiz_min = NULL;
+static float* hiz_max = NULL;
+static int hiz_width = 0, hiz_height = 0;
+// 上一次render_scene开启了深度测试且完整光栅化，深度缓冲区反映了该帧的场景
+static bool g_depth_valid = false;
+
+// 按窗口大小分配深度缓冲区和层次深度，清除由各图块在光栅化前完成
+static bool ensure_depth_buffer(int w, int h) {
     if (!depth_buffer || depth_buffer_w != w || depth_buffer_h != h) {
-        if (depth_buffer) free(depth_buffer);
+        free(depth_buffer);
+        free(hiz_min);
+        free(hiz_max);
+        hiz_width = (w + 7) / 8;
+        hiz_height = (h + 7) / 8;
         depth_buffer = malloc(sizeof(float) * w * h);
+        hiz_min = malloc(sizeof(float) * hiz_width * hiz_height);
+        hiz_max = malloc(sizeof(float) * hiz_width * hiz_height);
         depth_buffer_w = w;
         depth_buffer_h = h;
+        if (!depth_buffer || !hiz_min || !hiz_max) {
+            free(depth_buffer);
+            free(hiz_min);
+            free(hiz_max);
+            depth_buffer = hiz_min = hiz_max = NULL;
+            return false;
+        }
     }
-    for (int i = 0; i < w * h; ++i) depth_buffer[i] = -INFINITY;
+    return true;
 }
 
-static bool update_depth_buffer_if_closer(int x, int y, float inv_z) {
-    x = window_width/2 + x;
-    y = window_height/2 - y;
-    if (x < 0 || x >= window_width || y < 0 || y >= window_height) return false;
-    int offset = x + window_width * y;
-    if (depth_buffer[offset] < inv_z) {
-        depth_buffer[offset] = inv_z;
-        return true;
+void draw_line_depth(vec2_t p0, float z0, vec2_t p1, float z1, uint32_t color) {
+    bool has_depth = g_depth_valid && depth_buffer && depth_buffer_w == window_width && depth_buffer_h == window_height;
+    raster_line(p0, z0, p1, z1, color, has_depth ? depth_buffer : NULL, 0, 0, window_width - 1, window_height - 1);
+}
+
+// 块(bx, by)写入深度后重新计算它的最小值和最大值
+static void update_hiz_block(size_t block, int bx, int by, int cols, int rows) {
+    float lo = INFINITY, hi = -INFINITY;
+#if defined(__SSE2__) || defined(_M_X64)
+    if (cols == 8) {
+        __m128 vlo = _mm_set1_ps(INFINITY), vhi = _mm_set1_ps(-INFINITY);
+        for (int r = 0; r < rows; r++) {
+            const float* row = depth_buffer + (size_t)window_width * (by + r) + bx;
+            __m128 a = _mm_loadu_ps(row), b = _mm_loadu_ps(row + 4);
+            vlo = _mm_min_ps(vlo, _mm_min_ps(a, b));
+            vhi = _mm_max_ps(vhi, _mm_max_ps(a, b));
+        }
+        vlo = _mm_min_ps(vlo, _mm_shuffle_ps(vlo, vlo, _MM_SHUFFLE(1, 0, 3, 2)));
+        vlo = _mm_min_ps(vlo, _mm_shuffle_ps(vlo, vlo, _MM_SHUFFLE(2, 3, 0, 1)));
+        vhi = _mm_max_ps(vhi, _mm_shuffle_ps(vhi, vhi, _MM_SHUFFLE(1, 0, 3, 2)));
+        vhi = _mm_max_ps(vhi, _mm_shuffle_ps(vhi, vhi, _MM_SHUFFLE(2, 3, 0, 1)));
+        hiz_min[block] = _mm_cvtss_f32(vlo);
+        hiz_max[block] = _mm_cvtss_f32(vhi);
+        return;
+    }
+#endif
+    for (int r = 0; r < rows; r++) {
+        const float* row = depth_buffer + (size_t)window_width * (by + r) + bx;
+        for (int i = 0; i < cols; i++) {
+            lo = min_f(lo, row[i]);
+            hi = max_f(hi, row[i]);
+        }
     }
-    return false;
+    hiz_min[block] = lo;
+    hiz_max[block] = hi;
 }
 
+static raster_stats_t g_stats;
+
+raster_stats_t raster_get_stats(void) { return g_stats; }
+void raster_reset_stats(void) { g_stats = (raster_stats_t){0, 0}; }
+
 // 控制开关
 static bool g_enable_depth_test = true;
 static bool g_enable_backface_cull = true;
 static bool g_enable_triangle_outline = false;
+static bool g_enable_hierarchical_z = true;
+static bool g_enable_guard_band = true;
 
 void set_depth_test_enabled(bool enabled) { g_enable_depth_test = enabled; }
 void set_backface_cull_enabled(bool enabled) { g_enable_backface_cull = enabled; }
 void set_triangle_outline_enabled(bool enabled) { g_enable_triangle_outline = enabled; }
+void set_hierarchical_z_enabled(bool enabled) { g_enable_hierarchical_z = enabled; }
+void set_guard_band_enabled(bool enabled) { g_enable_guard_band = enabled; }
 
-// 填充三角形（带深度测试和背面剔除，可开关，支持描边）
-void render_filled_model(const model_t* model) {
-    float viewport_size = 1.0f;
-    float projection_plane_z = 1.0f;
-    if (g_enable_depth_test) {
-        clear_depth_buffer(window_width, window_height);
+// 着色方式，enabled为false时为平面着色
+static raster_shader_t g_shader = {0, NULL, NULL, false};
+static bool g_shader_enabled = false;
+
+void set_raster_shader(const raster_shader_t* shader) {
+    // 没有着色函数时只支持顶点颜色，否则退回平面着色
+    g_shader_enabled = shader && (shader->shade || (shader->varyings & RASTER_VARYING_COLOR));
+    if (g_shader_enabled) g_shader = *shader;
+}
+
+// 光照设置；render_scene每帧据此确定本帧的光照方式、属性组合和相机空间的光源
+static raster_lighting_mode_t g_lighting_mode = RASTER_LIGHTING_OFF;
+static light_t g_lights[LIGHTING_MAX_LIGHTS];
+static int g_light_count = 0;
+static float g_light_specular = -1;
+static raster_lighting_mode_t g_frame_lighting_mode = RASTER_LIGHTING_OFF;
+static int g_frame_varyings = 0;
+static lighting_t g_frame_lighting;
+
+void set_raster_lighting(raster_lighting_mode_t mode, const light_t* lights, int light_count, float specular) {
+    if (light_count < 0) light_count = 0;
+    if (light_count > LIGHTING_MAX_LIGHTS) light_count = LIGHTING_MAX_LIGHTS;
+    if (light_count > 0) memcpy(g_lights, lights, sizeof(light_t) * light_count);
+    g_lighting_mode = mode;
+    g_light_count = light_count;
+    g_light_specular = specular;
+}
+
+int raster_varying_count(int varyings) {
+    return ((varyings & RASTER_VARYING_COLOR) ? 3 : 0) +
+           ((varyings & RASTER_VARYING_NORMAL) ? 3 : 0) +
+           ((varyings & RASTER_VARYING_UV) ? 2 : 0);
+}
+
+#pragma endregion
+
+#pragma region 半空间光栅化
+
+// 顶点投影到屏幕后转为28.4定点数，边函数用整数精确计算，配合左上填充规则，
+// 相邻三角形的公共边上每个像素只被填充一次
+// 按8x8像素块遍历包围盒：整块在三角形外直接跳过，整块在内只做深度测试，
+// 其余块用SIMD一次计算4个像素的边函数
+#define RASTER_BLOCK 8
+
+// 边函数 E(x, y) = a * x + b * y + c，x, y为像素坐标，E >= 0表示在边的内侧（已含填充规则偏移）
+typedef struct {
+    int a, b;
+    int64_t c;
+} edge_t;
+
+// 三角形光栅化参数
+typedef struct {
+    edge_t edges[3];
+    float z0, dzdx, dzdy;   // 1/z在屏幕上线性变化：z0为像素(0, 0)处的值
+    float z_min, z_max;     // 顶点1/z的范围，已按z_slack放宽
+    float z_slack;          // 逐像素计算1/z的浮点误差余量
+    uint32_t color;
+    // 属性平面：属性乘以1/z后在屏幕上线性变化，依次为n个像素(0, 0)处的值、n个x方向和n个y方向的变化率
+    // 平面着色时为NULL
+    const float* varyings;
+    bool fill;              // 面积为0时只画描边
+    int x0, y0, x1, y1;     // 覆盖的像素范围（闭区间，已裁剪到屏幕），含描边
+    bool outline;
+    vec2_t outline_points[3];   // 描边顶点（画布坐标）
+    uint32_t outline_color;
+} raster_triangle_t;
+
+// 一次光栅化的像素计数
+typedef struct {
+    uint64_t fragments;     // 三角形覆盖的像素
+    uint64_t pixels;        // 通过深度测试并写入的像素
+} raster_counts_t;
+
+static edge_t make_edge(int x0, int y0, int x1, int y1) {
+    edge_t e;
+    int dx = x1 - x0, dy = y1 - y0;
+    // 像素(px, py)的采样点为(px * SUBPIXEL_ONE, py * SUBPIXEL_ONE)
+    e.a = -dy * SUBPIXEL_ONE;
+    e.b = dx * SUBPIXEL_ONE;
+    e.c = (int64_t)dy * x0 - (int64_t)dx * y0;
+    // 左上填充规则：只有上边（水平且内部在下方）和左边上的采样点算在内部
+    bool top_left = dy < 0 || (dy == 0 && dx > 0);
+    if (!top_left) e.c -= 1;
+    return e;
+}
+
+static inline int64_t edge_at(const edge_t* e, int x, int y) {
+    return (int64_t)e->a * x + (int64_t)e->b * y + e->c;
+}
+
+// 深度模式：关闭深度测试、只写入深度（层次深度确定整块都更近）、逐像素比较后写入
+enum { DEPTH_OFF, DEPTH_WRITE, DEPTH_TEST };
+
+// 强制内联：块函数以常量的深度模式、属性个数等参数调用，每种组合展开为一个专门的内层循环，
+// 循环内不再判断这些开关
+#if defined(_MSC_VER)
+#define RASTER_INLINE static __forceinline
+#else
+#define RASTER_INLINE static inline __attribute__((always_inline))
+#endif
+
+static int popcount4(int bits) {
+    static const int table[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+    return table[bits & 15];
+}
+
+// 逐像素处理一个块（位于屏幕右边缘不足8列，或没有SSE2时使用）
+RASTER_INLINE void raster_block_scalar(const raster_triangle_t* t, int bx, int by, int cols, int rows,
+                                       int test_edges, const int depth_mode, raster_counts_t* counts) {
+    for (int r = 0; r < rows; r++) {
+        int y = by + r;
+        size_t row = (size_t)window_width * y;
+        for (int i = 0; i < cols; i++) {
+            int x = bx + i;
+            bool inside = true;
+            for (int k = 0; k < 3; k++) {
+                if ((test_edges >> k & 1) && edge_at(&t->edges[k], x, y) < 0) inside = false;
+            }
+            if (!inside) continue;
+            counts->fragments++;
+            if (depth_mode != DEPTH_OFF) {
+                float z = t->z0 + t->dzdx * x + t->dzdy * y;
+                if (depth_mode == DEPTH_TEST && !(depth_buffer[row + x] < z)) continue;
+                depth_buffer[row + x] = z;
+            }
+            color_buffer[row + x] = t->color;
+            counts->pixels++;
+        }
     }
-    for (int i = 0; i < model->triangle_count; i++) {
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+// 每行分两组，每组4个像素；partial时才计算test_edges中各边的边函数
+// 块内的边函数值不超过边步长的8倍，可以用32位整数计算
+RASTER_INLINE void raster_block_sse2(const raster_triangle_t* t, int bx, int by, int rows,
+                                     int test_edges, const int depth_mode, raster_counts_t* counts) {
+    __m128i lane_e[3];
+    int32_t e_block[3];
+    for (int k = 0; k < 3; k++) {
+        const edge_t* e = &t->edges[k];
+        lane_e[k] = _mm_set_epi32(e->a * 3, e->a * 2, e->a, 0);
+        e_block[k] = (test_edges >> k & 1) ? (int32_t)edge_at(e, bx, by) : 0;
+    }
+    float z_block = t->z0 + t->dzdx * bx + t->dzdy * by;
+    if (test_edges == 0) {
+        // 整块在三角形内：每行是一个完整的像素段
+        for (int r = 0; r < rows; r++) {
+            size_t row = (size_t)window_width * (by + r) + bx;
+            counts->fragments += RASTER_BLOCK;
+            if (depth_mode != DEPTH_OFF) {
+                counts->pixels += span_fill_depth(color_buffer + row, depth_buffer + row, RASTER_BLOCK,
+                                                  t->color, z_block + t->dzdy * r, t->dzdx, depth_mode == DEPTH_TEST);
+            } else {
+                span_fill(color_buffer + row, RASTER_BLOCK, t->color);
+                counts->pixels += RASTER_BLOCK;
+            }
+        }
+        return;
+    }
+    __m128 lane_z = _mm_set_ps(t->dzdx * 3, t->dzdx * 2, t->dzdx, 0.0f);
+    __m128i color = _mm_set1_epi32((int)t->color);
+    __m128i minus_one = _mm_set1_epi32(-1);
+
+    for (int r = 0; r < rows; r++) {
+        size_t row = (size_t)window_width * (by + r) + bx;
+        float z_row = z_block + t->dzdy * r;
+        for (int h = 0; h < RASTER_BLOCK; h += 4) {
+            __m128i mask = minus_one;
+            for (int k = 0; k < 3; k++) {
+                if (!(test_edges >> k & 1)) continue;
+                int32_t base = e_block[k] + t->edges[k].b * r + t->edges[k].a * h;
+                __m128i e = _mm_add_epi32(_mm_set1_epi32(base), lane_e[k]);
+                mask = _mm_and_si128(mask, _mm_cmpgt_epi32(e, minus_one));
+            }
+            int covered = _mm_movemask_ps(_mm_castsi128_ps(mask));
+            if (!covered) continue;
+            counts->fragments += popcount4(covered);
+
+            if (depth_mode != DEPTH_OFF) {
+                __m128 z = _mm_add_ps(_mm_set1_ps(z_row + t->dzdx * h), lane_z);
+                __m128 d = _mm_loadu_ps(depth_buffer + row + h);
+                if (depth_mode == DEPTH_TEST) mask = _mm_and_si128(mask, _mm_castps_si128(_mm_cmplt_ps(d, z)));
+                __m128 m = _mm_castsi128_ps(mask);
+                _mm_storeu_ps(depth_buffer + row + h, _mm_or_ps(_mm_and_ps(m, z), _mm_andnot_ps(m, d)));
+            }
+            int written = _mm_movemask_ps(_mm_castsi128_ps(mask));
+            if (!written) continue;
+            counts->pixels += popcount4(written);
+            __m128i* dst = (__m128i*)(color_buffer + row + h);
+            __m128i old = _mm_loadu_si128(dst);
+            _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(mask, color), _mm_andnot_si128(mask, old)));
+        }
+    }
+}
+#endif
+
+// 平面着色的块：按深度模式展开
+static void raster_block_flat(const raster_triangle_t* t, int bx, int by, int cols, int rows,
+                              int test_edges, int depth_mode, raster_counts_t* counts) {
+#if defined(__SSE2__) || defined(_M_X64)
+    if (cols == RASTER_BLOCK) {
+        switch (depth_mode) {
+        case DEPTH_OFF: raster_block_sse2(t, bx, by, rows, test_edges, DEPTH_OFF, counts); return;
+        case DEPTH_WRITE: raster_block_sse2(t, bx, by, rows, test_edges, DEPTH_WRITE, counts); return;
+        default: raster_block_sse2(t, bx, by, rows, test_edges, DEPTH_TEST, counts); return;
+        }
+    }
+#endif
+    switch (depth_mode) {
+    case DEPTH_OFF: raster_block_scalar(t, bx, by, cols, rows, test_edges, DEPTH_OFF, counts); return;
+    case DEPTH_WRITE: raster_block_scalar(t, bx, by, cols, rows, test_edges, DEPTH_WRITE, counts); return;
+    default: raster_block_scalar(t, bx, by, cols, rows, test_edges, DEPTH_TEST, counts); return;
+    }
+}
+
+static inline uint32_t pack_color(float r, float g, float b, uint32_t alpha) {
+    r = r < 0.0f ? 0.0f : (r > 1.0f ? 1.0f : r);
+    g = g < 0.0f ? 0.0f : (g > 1.0f ? 1.0f : g);
+    b = b < 0.0f ? 0.0f : (b > 1.0f ? 1.0f : b);
+    return (alpha & 0xFF000000) | ((uint32_t)(r * 255.0f + 0.5f) << 16) |
+           ((uint32_t)(g * 255.0f + 0.5f) << 8) | (uint32_t)(b * 255.0f + 0.5f);
+}
+
+// 着色方式：内置的顶点颜色、逐像素调用着色函数、按2x2像素组调用着色函数（带导数）
+enum { SHADE_BUILTIN, SHADE_PIXEL, SHADE_QUAD, SHADE_MODE_COUNT };
+
+// 像素(x, y)处透视校正的属性：属性平面的值除以1/z
+RASTER_INLINE void interpolate_varyings(const raster_triangle_t* t, int x, int y, const int n, float* out) {
+    const float* q0 = t->varyings;
+    float w = 1.0f / (t->z0 + t->dzdx * x + t->dzdy * y);
+    for (int k = 0; k < n; k++) out[k] = (q0[k] + q0[n + k] * x + q0[2 * n + k] * y) * w;
+}
+
+// 逐像素光照：由像素坐标和z还原相机空间的位置（投影的逆变换），法向量为COLOR之后的三个属性，
+// 光照强度乘到颜色上
+RASTER_INLINE void light_pixel(float* v, int x, int y, float z) {
+    vec3_t point = {
+        (x - window_width * 0.5f) / window_width * z,
+        (window_height * 0.5f - y) / window_height * z,
+        z
+    };
+    float intensity = lighting_intensity(&g_frame_lighting, point, (vec3_t){v[3], v[4], v[5]});
+    v[0] *= intensity;
+    v[1] *= intensity;
+    v[2] *= intensity;
+}
+
+// 带属性插值的块：逐像素求1/z和各属性，属性除以1/z得到透视校正的值后着色
+// n为属性个数，SHADE_BUILTIN时属性的前三个为r, g, b；lit为逐像素光照（属性以COLOR、NORMAL开头）
+RASTER_INLINE void raster_block_shaded(const raster_triangle_t* t, int bx, int by, int cols, int rows,
+                                       int test_edges, raster_counts_t* counts,
+                                       const int depth_mode, const int n, const int shade_mode, const bool lit) {
+    fragment_shader_t shade = g_shader.shade;
+    const void* uniforms = g_shader.uniforms;
+    const float* q0 = t->varyings;
+    const float* dqdx = q0 + n;
+    const float* dqdy = q0 + 2 * n;
+    float q[RASTER_MAX_VARYINGS + 1], v[RASTER_MAX_VARYINGS + 1];
+    fragment_t fragment = {v, NULL, NULL, n, g_frame_varyings, 0, 0};
+    for (int r = 0; r < rows; r++) {
+        int y = by + r;
+        size_t row = (size_t)window_width * y;
+        int64_t e[3];
+        for (int k = 0; k < 3; k++) e[k] = edge_at(&t->edges[k], bx, y);
+        for (int k = 0; k < n; k++) q[k] = q0[k] + dqdx[k] * bx + dqdy[k] * y;
+        for (int i = 0; i < cols; i++) {
+            int x = bx + i;
+            bool inside = true;
+            for (int k = 0; k < 3; k++) {
+                if ((test_edges >> k & 1) && e[k] + (int64_t)t->edges[k].a * i < 0) inside = false;
+            }
+            if (inside) {
+                counts->fragments++;
+                float z = t->z0 + t->dzdx * x + t->dzdy * y;
+                bool pass = depth_mode != DEPTH_TEST || depth_buffer[row + x] < z;
+                if (pass) {
+                    if (depth_mode != DEPTH_OFF) depth_buffer[row + x] = z;
+                    float w = 1.0f / z;
+                    for (int k = 0; k < n; k++) v[k] = q[k] * w;
+                    if (lit) light_pixel(v, x, y, w);
+                    if (shade_mode == SHADE_PIXEL) {
+                        fragment.x = x;
+                        fragment.y = y;
+                        color_buffer[row + x] = shade(&fragment, t->color, uniforms);
+                    } else {
+                        // 内置着色总是带颜色属性（n >= 3），其余组合不会被选用
+                        color_buffer[row + x] = n >= 3 ? pack_color(v[0], v[1], v[2], t->color) : t->color;
+                    }
+                    counts->pixels++;
+                }
+            }
+            for (int k = 0; k < n; k++) q[k] += dqdx[k];
+        }
+    }
+}
+
+// 按2x2像素组处理块：组内有像素在三角形内时四个像素都计算属性（包括三角形外和屏幕外的像素），
+// 右边与左边、下边与上边的差作为整组共用的屏幕导数，与GPU的粗粒度导数相同
+RASTER_INLINE void raster_block_quads(const raster_triangle_t* t, int bx, int by, int cols, int rows,
+                                      int test_edges, raster_counts_t* counts,
+                                      const int depth_mode, const int n, const bool lit) {
+    fragment_shader_t shade = g_shader.shade;
+    const void* uniforms = g_shader.uniforms;
+    float v[4][RASTER_MAX_VARYINGS + 1], ddx[RASTER_MAX_VARYINGS + 1], ddy[RASTER_MAX_VARYINGS + 1];
+    for (int r = 0; r < rows; r += 2) {
+        for (int i = 0; i < cols; i += 2) {
+            int covered = 0;
+            for (int p = 0; p < 4; p++) {
+                int px = i + (p & 1), py = r + (p >> 1);
+                if (px >= cols || py >= rows) continue;
+                bool inside = true;
+                for (int k = 0; k < 3; k++) {
+                    if ((test_edges >> k & 1) && edge_at(&t->edges[k], bx + px, by + py) < 0) inside = false;
+                }
+                if (inside) covered |= 1 << p;
+            }
+            if (!covered) continue;
+            int x = bx + i, y = by + r;
+            for (int p = 0; p < 4; p++) interpolate_varyings(t, x + (p & 1), y + (p >> 1), n, v[p]);
+            for (int k = 0; k < n; k++) {
+                ddx[k] = v[1][k] - v[0][k];
+                ddy[k] = v[2][k] - v[0][k];
+            }
+            for (int p = 0; p < 4; p++) {
+                if (!(covered >> p & 1)) continue;
+                int px = x + (p & 1), py = y + (p >> 1);
+                size_t index = (size_t)window_width * py + px;
+                counts->fragments++;
+                float z = t->z0 + t->dzdx * px + t->dzdy * py;
+                if (depth_mode == DEPTH_TEST && !(depth_buffer[index] < z)) continue;
+                if (depth_mode != DEPTH_OFF) depth_buffer[index] = z;
+                // 导数取自光照前的属性
+                if (lit) light_pixel(v[p], px, py, 1.0f / z);
+                fragment_t fragment = {v[p], ddx, ddy, n, g_frame_varyings, px, py};
+                color_buffer[index] = shade(&fragment, t->color, uniforms);
+                counts->pixels++;
+            }
+        }
+    }
+}
+
+typedef void (*shaded_block_fn)(const raster_triangle_t* t, int bx, int by, int cols, int rows,
+                                int test_edges, raster_counts_t* counts);
+
+// 每种（光照，属性个数，着色方式，深度模式）组合生成一个函数，逐像素光照的函数名带lit_前缀
+#define DEFINE_SHADED_BLOCK(PREFIX, LIT, N, DEPTH) \
+    static void raster_block_##PREFIX##builtin_##N##_##DEPTH(const raster_triangle_t* t, int bx, int by, \
+                                                             int cols, int rows, int test_edges, raster_counts_t* counts) { \
+        raster_block_shaded(t, bx, by, cols, rows, test_edges, counts, DEPTH, N, SHADE_BUILTIN, LIT); \
+    } \
+    static void raster_block_##PREFIX##pixel_##N##_##DEPTH(const raster_triangle_t* t, int bx, int by, \
+                                                           int cols, int rows, int test_edges, raster_counts_t* counts) { \
+        raster_block_shaded(t, bx, by, cols, rows, test_edges, counts, DEPTH, N, SHADE_PIXEL, LIT); \
+    } \
+    static void raster_block_##PREFIX##quad_##N##_##DEPTH(const raster_triangle_t* t, int bx, int by, \
+                                                          int cols, int rows, int test_edges, raster_counts_t* counts) { \
+        raster_block_quads(t, bx, by, cols, rows, test_edges, counts, DEPTH, N, LIT); \
+    }
+#define DEFINE_SHADED_BLOCKS(PREFIX, LIT, N) \
+    DEFINE_SHADED_BLOCK(PREFIX, LIT, N, DEPTH_OFF) DEFINE_SHADED_BLOCK(PREFIX, LIT, N, DEPTH_WRITE) \
+    DEFINE_SHADED_BLOCK(PREFIX, LIT, N, DEPTH_TEST)
+#define SHADED_BLOCK_MODE(PREFIX, MODE, N) \
+    { raster_block_##PREFIX##MODE##_##N##_DEPTH_OFF, raster_block_##PREFIX##MODE##_##N##_DEPTH_WRITE, \
+      raster_block_##PREFIX##MODE##_##N##_DEPTH_TEST }
+#define SHADED_BLOCK_ENTRY(PREFIX, N) \
+    [N] = { SHADED_BLOCK_MODE(PREFIX, builtin, N), SHADED_BLOCK_MODE(PREFIX, pixel, N), SHADED_BLOCK_MODE(PREFIX, quad, N) }
+
+// 属性个数只可能是COLOR(3)、NORMAL(3)、UV(2)组合出的0、2、3、5、6、8
+// 逐像素光照要求COLOR和NORMAL，属性个数只可能是6、8
+DEFINE_SHADED_BLOCKS(, false, 0)
+DEFINE_SHADED_BLOCKS(, false, 2)
+DEFINE_SHADED_BLOCKS(, false, 3)
+DEFINE_SHADED_BLOCKS(, false, 5)
+DEFINE_SHADED_BLOCKS(, false, 6)
+DEFINE_SHADED_BLOCKS(, false, 8)
+DEFINE_SHADED_BLOCKS(lit_, true, 6)
+DEFINE_SHADED_BLOCKS(lit_, true, 8)
+
+// [逐像素光照][属性个数][着色方式][深度模式]
+static const shaded_block_fn g_shaded_blocks[2][RASTER_MAX_VARYINGS + 1][SHADE_MODE_COUNT][3] = {
+    {
+        SHADED_BLOCK_ENTRY(, 0), SHADED_BLOCK_ENTRY(, 2), SHADED_BLOCK_ENTRY(, 3),
+        SHADED_BLOCK_ENTRY(, 5), SHADED_BLOCK_ENTRY(, 6), SHADED_BLOCK_ENTRY(, 8)
+    },
+    { SHADED_BLOCK_ENTRY(lit_, 6), SHADED_BLOCK_ENTRY(lit_, 8) }
+};
+
+// 本帧使用的带属性块函数（按深度模式），平面着色时为NULL
+static const shaded_block_fn* g_frame_shaded_block = NULL;
+
+// 边函数在以(bx, by)为左上角、边长span + 1的方块内的最小/最大值取在角上
+// 方块在某条边外侧时返回-1，否则返回跨过方块、需要逐像素测试的边的位掩码
+static int classify_block(const raster_triangle_t* t, int bx, int by, int span) {
+    int test_edges = 0;
+    for (int k = 0; k < 3; k++) {
+        const edge_t* e = &t->edges[k];
+        int64_t corner = edge_at(e, bx, by);
+        int64_t lo = corner + (e->a < 0 ? (int64_t)e->a * span : 0) + (e->b < 0 ? (int64_t)e->b * span : 0);
+        int64_t hi = corner + (e->a > 0 ? (int64_t)e->a * span : 0) + (e->b > 0 ? (int64_t)e->b * span : 0);
+        if (hi < 0) return -1;
+        if (lo < 0) test_edges |= 1 << k;
+    }
+    return test_edges;
+}
+
+static float unpack_channel(uint32_t color, int shift) {
+    return ((color >> shift) & 0xFF) * (1.0f / 255.0f);
+}
+
+// 逐顶点光照时原三角形三个顶点的光照强度：取变换时批量计算的结果，模型没有顶点法向量时用面法向量计算
+static void vertex_light(const transformed_model_t* model, triangle_t src, float light[3]) {
+    int v[3] = {src.v0, src.v1, src.v2};
+    if (model->light) {
+        for (int i = 0; i < 3; i++) light[i] = model->light[v[i]];
+        return;
+    }
+    vec3_t face = compute_triangle_normal(model->vertexes[src.v0], model->vertexes[src.v1], model->vertexes[src.v2]);
+    for (int i = 0; i < 3; i++) light[i] = lighting_intensity(&g_frame_lighting, model->vertexes[v[i]], face);
+}
+
+// 原三角形三个顶点的属性（按varyings的顺序紧凑排列），逐顶点光照时颜色已乘以光照强度
+static void source_varyings(const transformed_model_t* model, triangle_t src, int varyings,
+                            float attr[3][RASTER_MAX_VARYINGS]) {
+    const model_t* m = model->source;
+    int v[3] = {src.v0, src.v1, src.v2};
+    int k = 0;
+    if (varyings & RASTER_VARYING_COLOR) {
+        float light[3] = {1.0f, 1.0f, 1.0f};
+        if (g_frame_lighting_mode == RASTER_LIGHTING_VERTEX) vertex_light(model, src, light);
+        for (int i = 0; i < 3; i++) {
+            uint32_t c = m->colors ? m->colors[v[i]] : src.color;
+            attr[i][k] = unpack_channel(c, 16) * light[i];
+            attr[i][k + 1] = unpack_channel(c, 8) * light[i];
+            attr[i][k + 2] = unpack_channel(c, 0) * light[i];
+        }
+        k += 3;
+    }
+    if (varyings & RASTER_VARYING_NORMAL) {
+        vec3_t face = {0, 0, 0};
+        if (!m->normals) {
+            face = compute_triangle_normal(model->vertexes[src.v0], model->vertexes[src.v1], model->vertexes[src.v2]);
+        }
+        for (int i = 0; i < 3; i++) {
+            vec3_t n = m->normals ? mat3_mul_vec3(&model->normal_matrix, m->normals[v[i]]) : face;
+            attr[i][k] = n.x;
+            attr[i][k + 1] = n.y;
+            attr[i][k + 2] = n.z;
+        }
+        k += 3;
+    }
+    if (varyings & RASTER_VARYING_UV) {
+        for (int i = 0; i < 3; i++) {
+            vec2_t uv = m->uvs ? m->uvs[v[i]] : (vec2_t){0, 0};
+            attr[i][k] = uv.x;
+            attr[i][k + 1] = uv.y;
+        }
+    }
+}
+
+// 三角形各顶点的属性：原模型的顶点直接取值，裁剪产生的顶点按重心坐标混合原三角形的顶点
+static void corner_varyings(const transformed_model_t* model, int triangle_index, int varyings,
+                            float out[3][RASTER_MAX_VARYINGS]) {
+    int n = raster_varying_count(varyings);
+    int source_index = model->source_triangles ? model->source_triangles[triangle_index] : triangle_index;
+    triangle_t src = model->source->triangles[source_index];
+    float attr[3][RASTER_MAX_VARYINGS];
+    source_varyings(model, src, varyings, attr);
+    triangle_t tri = model->triangles[triangle_index];
+    int corners[3] = {tri.v0, tri.v1, tri.v2};
+    for (int i = 0; i < 3; i++) {
+        int v = corners[i];
+        int j = v == src.v0 ? 0 : v == src.v1 ? 1 : v == src.v2 ? 2 : -1;
+        if (j >= 0) {
+            for (int k = 0; k < n; k++) out[i][k] = attr[j][k];
+        } else {
+            vec3_t w = model->clip_weights[v - model->source->vertex_count];
+            for (int k = 0; k < n; k++) out[i][k] = w.x * attr[0][k] + w.y * attr[1][k] + w.z * attr[2][k];
+        }
+    }
+}
+
+// 三角形设置：用已投影的顶点（z > 0）计算边函数、深度平面和包围盒
+// varyings不为NULL时（3 * 属性个数个float）同时计算透视校正的属性平面
+// 三角形不覆盖任何像素且没有描边时返回false
+static bool setup_triangle(const transformed_model_t* model, int triangle_index, bool outline,
+                           float* varyings, raster_triangle_t* t) {
+    triangle_t tri = model->triangles[triangle_index];
+    const projected_vertex_t* v[3] = {
+        &model->projected[tri.v0], &model->projected[tri.v1], &model->projected[tri.v2]
+    };
+    uint32_t color = tri.color;
+    int X[3] = {v[0]->x, v[1]->x, v[2]->x};
+    int Y[3] = {v[0]->y, v[1]->y, v[2]->y};
+    float iz[3] = {v[0]->iz, v[1]->iz, v[2]->iz};
+    int corner[3] = {0, 1, 2};
+    t->color = color;
+    t->outline = outline;
+    t->varyings = NULL;
+
+    // 统一为E >= 0在内侧的环绕方向
+    int64_t area = (int64_t)(X[1] - X[0]) * (Y[2] - Y[0]) - (int64_t)(Y[1] - Y[0]) * (X[2] - X[0]);
+    if (area < 0) {
+        int tx = X[1]; X[1] = X[2]; X[2] = tx;
+        int ty = Y[1]; Y[1] = Y[2]; Y[2] = ty;
+        float tz = iz[1]; iz[1] = iz[2]; iz[2] = tz;
+        corner[1] = 2; corner[2] = 1;
+    }
+
+    // 包围盒（像素）
+    int min_x = X[0] < X[1] ? (X[0] < X[2] ? X[0] : X[2]) : (X[1] < X[2] ? X[1] : X[2]);
+    int max_x = X[0] > X[1] ? (X[0] > X[2] ? X[0] : X[2]) : (X[1] > X[2] ? X[1] : X[2]);
+    int min_y = Y[0] < Y[1] ? (Y[0] < Y[2] ? Y[0] : Y[2]) : (Y[1] < Y[2] ? Y[1] : Y[2]);
+    int max_y = Y[0] > Y[1] ? (Y[0] > Y[2] ? Y[0] : Y[2]) : (Y[1] > Y[2] ? Y[1] : Y[2]);
+    t->x0 = (min_x + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+    t->y0 = (min_y + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+    t->x1 = max_x >> SUBPIXEL_BITS;
+    t->y1 = max_y >> SUBPIXEL_BITS;
+    t->fill = area != 0 && t->x0 <= t->x1 && t->y0 <= t->y1;
+
+    if (outline) {
+        for (int i = 0; i < 3; i++) {
+            t->outline_points[i] = (vec2_t){(float)v[i]->ox, (float)v[i]->oy};
+            // 描边像素不超出端点的范围
+            int px = window_width / 2 + v[i]->ox;
+            int py = window_height / 2 - v[i]->oy;
+            if (px < t->x0) t->x0 = px;
+            if (px > t->x1) t->x1 = px;
+            if (py < t->y0) t->y0 = py;
+            if (py > t->y1) t->y1 = py;
+        }
+        // 取较暗色
+        t->outline_color = (color & 0xFF000000) | (((((color>>16)&0xFF)*3/4)<<16) | ((((color>>8)&0xFF)*3/4)<<8) | (((color)&0xFF)*3/4));
+    }
+
+    if (t->x0 < 0) t->x0 = 0;
+    if (t->y0 < 0) t->y0 = 0;
+    if (t->x1 > window_width - 1) t->x1 = window_width - 1;
+    if (t->y1 > window_height - 1) t->y1 = window_height - 1;
+    if (t->x0 > t->x1 || t->y0 > t->y1) return false;
+    if (!t->fill) return outline;
+
+    t->edges[0] = make_edge(X[1], Y[1], X[2], Y[2]);
+    t->edges[1] = make_edge(X[2], Y[2], X[0], Y[0]);
+    t->edges[2] = make_edge(X[0], Y[0], X[1], Y[1]);
+
+    // 1/z的平面方程，用定点化后的顶点坐标求解
+    float fx0 = X[0] / (float)SUBPIXEL_ONE, fy0 = Y[0] / (float)SUBPIXEL_ONE;
+    float fx1 = X[1] / (float)SUBPIXEL_ONE - fx0, fy1 = Y[1] / (float)SUBPIXEL_ONE - fy0;
+    float fx2 = X[2] / (float)SUBPIXEL_ONE - fx0, fy2 = Y[2] / (float)SUBPIXEL_ONE - fy0;
+    float det = fx1 * fy2 - fx2 * fy1;
+    float dz1 = iz[1] - iz[0], dz2 = iz[2] - iz[0];
+    t->dzdx = (dz1 * fy2 - dz2 * fy1) / det;
+    t->dzdy = (dz2 * fx1 - dz1 * fx2) / det;
+    t->z0 = iz[0] - t->dzdx * fx0 - t->dzdy * fy0;
+    // 块内各像素的1/z按不同顺序累加，与平面上的精确值相差若干ulp
+    t->z_slack = 1e-5f * (fabsf(t->z0) + fabsf(t->dzdx) * window_width + fabsf(t->dzdy) * window_height);
+    t->z_min = min_f(iz[0], min_f(iz[1], iz[2])) - t->z_slack;
+    t->z_max = max_f(iz[0], max_f(iz[1], iz[2])) + t->z_slack;
+
+    if (varyings) {
+        // 属性乘以1/z后与1/z一样在屏幕上线性变化，用同一组系数求平面方程
+        int n = raster_varying_count(g_frame_varyings);
+        float attr[3][RASTER_MAX_VARYINGS];
+        corner_varyings(model, triangle_index, g_frame_varyings, attr);
+        for (int k = 0; k < n; k++) {
+            float q0 = attr[corner[0]][k] * iz[0];
+            float dq1 = attr[corner[1]][k] * iz[1] - q0, dq2 = attr[corner[2]][k] * iz[2] - q0;
+            float dqdx = (dq1 * fy2 - dq2 * fy1) / det;
+            float dqdy = (dq2 * fx1 - dq1 * fx2) / det;
+            varyings[k] = q0 - dqdx * fx0 - dqdy * fy0;
+            varyings[n + k] = dqdx;
+            varyings[2 * n + k] = dqdy;
+        }
+        t->varyings = varyings;
+    }
+    return true;
+}
+
+// 三角形在像素矩形[x0, x1] x [y0, y1]内1/z的下界和上界
+static void triangle_depth_range(const raster_triangle_t* t, int x0, int y0, int x1, int y1,
+                                 float* z_lo, float* z_hi) {
+    float lo = t->z0 + t->dzdx * (t->dzdx < 0 ? x1 : x0) + t->dzdy * (t->dzdy < 0 ? y1 : y0) - t->z_slack;
+    float hi = t->z0 + t->dzdx * (t->dzdx > 0 ? x1 : x0) + t->dzdy * (t->dzdy > 0 ? y1 : y0) + t->z_slack;
+    *z_lo = max_f(lo, t->z_min);
+    *z_hi = min_f(hi, t->z_max);
+}
+
+// 光栅化三角形落在像素矩形[rx0, rx1] x [ry0, ry1]内的部分，矩形左上角需按块对齐
+// 返回是否写入了深度（用于更新图块级的层次深度）
+static bool rasterize_triangle(const raster_triangle_t* t, int rx0, int ry0, int rx1, int ry1,
+                               raster_counts_t* counts) {
+    int x0 = t->x0 > rx0 ? t->x0 : rx0;
+    int y0 = t->y0 > ry0 ? t->y0 : ry0;
+    int x1 = t->x1 < rx1 ? t->x1 : rx1;
+    int y1 = t->y1 < ry1 ? t->y1 : ry1;
+    bool use_hiz = g_enable_depth_test && g_enable_hierarchical_z;
+    bool written = false;
+    for (int by = y0 & ~(RASTER_BLOCK - 1); by <= y1; by += RASTER_BLOCK) {
+        int rows = ry1 + 1 - by < RASTER_BLOCK ? ry1 + 1 - by : RASTER_BLOCK;
+        for (int bx = x0 & ~(RASTER_BLOCK - 1); bx <= x1; bx += RASTER_BLOCK) {
+            int test_edges = classify_block(t, bx, by, RASTER_BLOCK - 1);
+            if (test_edges < 0) continue;
+            int cols = rx1 + 1 - bx < RASTER_BLOCK ? rx1 + 1 - bx : RASTER_BLOCK;
+
+            // 层次深度：整块都不比已有深度更近时跳过，整块都更近时省去逐像素比较
+            int depth_mode = g_enable_depth_test ? DEPTH_TEST : DEPTH_OFF;
+            size_t block = 0;
+            if (use_hiz) {
+                block = (size_t)hiz_width * (by / RASTER_BLOCK) + bx / RASTER_BLOCK;
+                float z_lo, z_hi;
+                triangle_depth_range(t, bx, by, bx + cols - 1, by + rows - 1, &z_lo, &z_hi);
+                if (z_hi <= hiz_min[block]) {
+                    PROFILE_COUNT(PROFILE_COUNTER_HIZ_BLOCKS_REJECTED, 1);
+                    continue;
+                }
+                if (z_lo > hiz_max[block]) depth_mode = DEPTH_WRITE;
+            }
+
+            uint64_t pixels = counts->pixels;
+            if (g_frame_shaded_block) {
+                g_frame_shaded_block[depth_mode](t, bx, by, cols, rows, test_edges, counts);
+            } else {
+                raster_block_flat(t, bx, by, cols, rows, test_edges, depth_mode, counts);
+            }
+
+            if (counts->pixels != pixels && g_enable_depth_test) {
+                written = true;
+                if (use_hiz) update_hiz_block(block, bx, by, cols, rows);
+            }
+        }
+    }
+    return written;
+}
+
+#pragma endregion
+
+#pragma region 分块并行光栅化
+
+// 排序中间（sort-middle）架构：裁剪后的三角形先完成设置并按屏幕图块装箱，
+// 每帧末尾各图块在线程池上独立光栅化，每个线程只写自己图块范围内的颜色和深度缓冲区，无需加锁
+// 装箱按三角形分组并行，合并时保持提交顺序，每个图块内按提交顺序绘制，因此结果与线程数无关
+#define RASTER_TILE 64
+
+typedef struct {
+    int* items;             // 三角形下标，按提交顺序
+    int count;
+    int capacity;
+} raster_bin_t;
+
+static thread_pool_t* g_raster_pool = NULL;
+static arena_t g_frame_arena = {0};       // 每帧变换和裁剪的临时数据
+static raster_triangle_t* g_triangles = NULL;
+static int g_triangle_count = 0, g_triangle_capacity = 0;
+static raster_bin_t* g_bins = NULL;
+static raster_counts_t* g_tile_counts = NULL;
+static int g_tiles_x = 0, g_tiles_y = 0;
+
+void set_raster_thread_pool(thread_pool_t* pool) { g_raster_pool = pool; }
+
+// 清空上一帧的装箱结果，窗口大小变化时重建图块
+static bool begin_binning(void) {
+    int tiles_x = (window_width + RASTER_TILE - 1) / RASTER_TILE;
+    int tiles_y = (window_height + RASTER_TILE - 1) / RASTER_TILE;
+    if (tiles_x != g_tiles_x || tiles_y != g_tiles_y) {
+        for (int i = 0; i < g_tiles_x * g_tiles_y; i++) free(g_bins[i].items);
+        free(g_bins);
+        free(g_tile_counts);
+        g_bins = calloc((size_t)tiles_x * tiles_y, sizeof(raster_bin_t));
+        g_tile_counts = malloc(sizeof(raster_counts_t) * tiles_x * tiles_y);
+        if (!g_bins || !g_tile_counts) {
+            free(g_bins);
+            free(g_tile_counts);
+            g_bins = NULL;
+            g_tile_counts = NULL;
+            g_tiles_x = g_tiles_y = 0;
+            return false;
+        }
+        g_tiles_x = tiles_x;
+        g_tiles_y = tiles_y;
+    }
+    for (int i = 0; i < g_tiles_x * g_tiles_y; i++) g_bins[i].count = 0;
+    g_triangle_count = 0;
+    return true;
+}
+
+// 保证图块列表能容纳count项
+static bool bin_reserve(raster_bin_t* bin, int count) {
+    if (count <= bin->capacity) return true;
+    int capacity = bin->capacity ? bin->capacity : 64;
+    while (capacity < count) capacity *= 2;
+    int* items = realloc(bin->items, sizeof(int) * capacity);
+    if (!items) return false;
+    bin->items = items;
+    bin->capacity = capacity;
+    return true;
+}
+
+// 并行装箱：三角形按BIN_BATCH个一组在线程池上完成背面剔除、设置和图块覆盖计算，
+// 每组先把(图块, 三角形)写入自己的列表，再按组的顺序合并到各图块，图块内仍是提交顺序
+// 组数不到4个时在调用线程上依次处理
+#define BIN_BATCH 4096
+
+typedef struct {
+    int (*entries)[2];      // 图块下标和三角形下标，按提交顺序
+    int count;
+    int capacity;
+} bin_chunk_t;
+
+static bin_chunk_t* g_bin_chunks = NULL;
+static int g_bin_chunk_capacity = 0;
+
+typedef struct {
+    const transformed_model_t* model;
+    float* varyings;        // 属性平面，每个三角形varying_count * 3个float
+    int varying_count;
+    int base;               // 模型的三角形在g_triangles中的起始位置，第i组使用base + i * BIN_BATCH起的位置
+    int* tile_counts;       // 每组各图块的项数，合并时改为该组在图块列表中的写入位置（-1表示丢弃）
+} bin_job_t;
+
+static bool chunk_push(bin_chunk_t* chunk, int tile, int triangle) {
+    if (chunk->count == chunk->capacity) {
+        int capacity = chunk->capacity ? chunk->capacity * 2 : 1024;
+        int (*entries)[2] = realloc(chunk->entries, sizeof(int[2]) * capacity);
+        if (!entries) return false;
+        chunk->entries = entries;
+        chunk->capacity = capacity;
+    }
+    chunk->entries[chunk->count][0] = tile;
+    chunk->entries[chunk->count][1] = triangle;
+    chunk->count++;
+    return true;
+}
+
+// 剔除并设置一组三角形，通过的三角形在组内连续存放，记录它们覆盖的图块
+static void bin_chunk_task(void* ctx, int task_index, int worker_index) {
+    (void)worker_index;
+    const bin_job_t* job = ctx;
+    const transformed_model_t* model = job->model;
+    bin_chunk_t* chunk = &g_bin_chunks[task_index];
+    int* tile_counts = job->tile_counts + (size_t)task_index * g_tiles_x * g_tiles_y;
+    int n = job->varying_count;
+    int begin = task_index * BIN_BATCH;
+    int end = begin + BIN_BATCH < model->triangle_count ? begin + BIN_BATCH : model->triangle_count;
+    int next = job->base + begin;
+    chunk->count = 0;
+    for (int i = begin; i < end; i++) {
         triangle_t tri = model->triangles[i];
         vec3_t v0 = model->vertexes[tri.v0];
         vec3_t v1 = model->vertexes[tri.v1];
         vec3_t v2 = model->vertexes[tri.v2];
-        if (g_enable_backface_cull && is_backface(v0, v1, v2)) continue;
-        // 投影
-        vec2_t p0 = project_vertex(v0, window_width, window_height, viewport_size, projection_plane_z);
-        vec2_t p1 = project_vertex(v1, window_width, window_height, viewport_size, projection_plane_z);
-        vec2_t p2 = project_vertex(v2, window_width, window_height, viewport_size, projection_plane_z);
-        // 按y排序
-        if (p1.y < p0.y) { vec2_t tp = p0; p0 = p1; p1 = tp; float tz = v0.z; v0.z = v1.z; v1.z = tz; }
-        if (p2.y < p0.y) { vec2_t tp = p0; p0 = p2; p2 = tp; float tz = v0.z; v0.z = v2.z; v2.z = tz; }
-        if (p2.y < p1.y) { vec2_t tp = p1; p1 = p2; p2 = tp; float tz = v1.z; v1.z = v2.z; v2.z = tz; }
-        // 计算三条边的x坐标和1/z插值
-        int x01_len, x12_len, x02_len;
-        int x01[2048], x12[2048], x02[2048];
-        interpolate(p0.y, p0.x, p1.y, p1.x, x01, &x01_len);
-        interpolate(p1.y, p1.x, p2.y, p2.x, x12, &x12_len);
-        interpolate(p0.y, p0.x, p2.y, p2.x, x02, &x02_len);
-        // 1/z插值
-        float iz0 = 1.0f/v0.z, iz1 = 1.0f/v1.z, iz2 = 1.0f/v2.z;
-        int iz01_len, iz12_len, iz02_len;
-        float iz01[2048], iz12[2048], iz02[2048];
-        interpolate_float(p0.y, iz0, p1.y, iz1, iz01, &iz01_len);
-        interpolate_float(p1.y, iz1, p2.y, iz2, iz12, &iz12_len);
-        interpolate_float(p0.y, iz0, p2.y, iz2, iz02, &iz02_len);
-        // 合并两条短边
-        int x012[4096], x012_len = 0;
-        float iz012[4096]; int iz012_len = 0;
-        for (int i = 0; i < x01_len - 1; i++) { x012[x012_len++] = x01[i]; iz012[iz012_len++] = iz01[i]; }
-        for (int i = 0; i < x12_len; i++) { x012[x012_len++] = x12[i]; iz012[iz012_len++] = iz12[i]; }
-        // 确定哪边是左边，哪边是右边
-        int* x_left; int* x_right; float* iz_left; float* iz_right;
-        int m = x02_len / 2;
-        if (x02[m] < x012[m]) { x_left = x02; iz_left = iz02; x_right = x012; iz_right = iz012; }
-        else { x_left = x012; iz_left = iz012; x_right = x02; iz_right = iz02; }
-        // 绘制水平线段
-        for (int y = p0.y; y <= p2.y; y++) {
-            int idx = y - p0.y;
-            if (idx < x02_len && idx < x012_len) {
-                int xl = x_left[idx];
-                int xr = x_right[idx];
-                float izl = iz_left[idx];
-                float izr = iz_right[idx];
-                int seg_len = xr - xl + 1;
-                if (seg_len <= 0) continue;
-                float izstep = (izr - izl) / (float)(xr - xl == 0 ? 1 : xr - xl);
-                float izval = izl;
-                for (int x = xl; x <= xr; x++) {
-                    bool pass_depth = true;
-                    if (g_enable_depth_test) {
-                        pass_depth = update_depth_buffer_if_closer(x, y, izval);
-                    }
-                    if (pass_depth) {
-                        draw_pixel(x, y, tri.color);
+        if (g_enable_backface_cull && is_backface(v0, v1, v2)) {
+            PROFILE_COUNT(PROFILE_COUNTER_TRIANGLES_CULLED, 1);
+            continue;
+        }
+        raster_triangle_t* t = &g_triangles[next];
+        float* varyings = job->varyings ? job->varyings + (size_t)3 * n * i : NULL;
+        if (!setup_triangle(model, i, g_enable_triangle_outline, varyings, t)) continue;
+        for (int ty = t->y0 / RASTER_TILE; ty <= t->y1 / RASTER_TILE; ty++) {
+            for (int tx = t->x0 / RASTER_TILE; tx <= t->x1 / RASTER_TILE; tx++) {
+                // 大三角形的包围盒中有些图块完全在三角形外；描边可能略超出三角形，不能剔除
+                if (!t->outline && classify_block(t, tx * RASTER_TILE, ty * RASTER_TILE, RASTER_TILE - 1) < 0) continue;
+                int tile = ty * g_tiles_x + tx;
+                if (chunk_push(chunk, tile, next)) tile_counts[tile]++;
+            }
+        }
+        next++;
+    }
+}
+
+// 把一组的列表写入各图块中该组的位置
+static void bin_scatter_task(void* ctx, int task_index, int worker_index) {
+    (void)worker_index;
+    const bin_job_t* job = ctx;
+    const bin_chunk_t* chunk = &g_bin_chunks[task_index];
+    int* offsets = job->tile_counts + (size_t)task_index * g_tiles_x * g_tiles_y;
+    for (int i = 0; i < chunk->count; i++) {
+        int tile = chunk->entries[i][0];
+        if (offsets[tile] >= 0) g_bins[tile].items[offsets[tile]++] = chunk->entries[i][1];
+    }
+}
+
+// 背面剔除后把模型的三角形装箱（顶点已在相机空间并完成裁剪）
+static void bin_filled_model(const transformed_model_t* model) {
+    PROFILE_BEGIN(PROFILE_STAGE_BIN);
+    int tiles = g_tiles_x * g_tiles_y;
+    int chunks = (model->triangle_count + BIN_BATCH - 1) / BIN_BATCH;
+    // 每个三角形预留一个位置，被剔除的位置不使用
+    bool ok = chunks > 0;
+    if (ok && g_triangle_count + model->triangle_count > g_triangle_capacity) {
+        int capacity = g_triangle_capacity ? g_triangle_capacity : 1024;
+        while (capacity < g_triangle_count + model->triangle_count) capacity *= 2;
+        raster_triangle_t* triangles = realloc(g_triangles, sizeof(raster_triangle_t) * capacity);
+        ok = triangles != NULL;
+        if (ok) {
+            g_triangles = triangles;
+            g_triangle_capacity = capacity;
+        }
+    }
+    if (ok && chunks > g_bin_chunk_capacity) {
+        bin_chunk_t* grown = realloc(g_bin_chunks, sizeof(bin_chunk_t) * chunks);
+        ok = grown != NULL;
+        if (ok) {
+            memset(grown + g_bin_chunk_capacity, 0, sizeof(bin_chunk_t) * (chunks - g_bin_chunk_capacity));
+            g_bin_chunks = grown;
+            g_bin_chunk_capacity = chunks;
+        }
+    }
+    // 属性平面和各组的图块计数分配在帧arena上
+    bin_job_t job = {model, NULL, raster_varying_count(g_frame_varyings), g_triangle_count, NULL};
+    if (ok && job.varying_count > 0) {
+        job.varyings = arena_alloc(&g_frame_arena, sizeof(float) * 3 * job.varying_count * model->triangle_count);
+        ok = job.varyings != NULL;
+    }
+    if (ok) {
+        job.tile_counts = arena_alloc(&g_frame_arena, sizeof(int) * (size_t)chunks * tiles);
+        ok = job.tile_counts != NULL;
+    }
+    if (!ok) {
+        PROFILE_END(PROFILE_STAGE_BIN);
+        return;
+    }
+    memset(job.tile_counts, 0, sizeof(int) * (size_t)chunks * tiles);
+    g_triangle_count += model->triangle_count;
+
+    bool parallel = g_raster_pool && chunks >= 4;
+    if (parallel) {
+        thread_pool_run(g_raster_pool, chunks, bin_chunk_task, &job);
+    } else {
+        for (int c = 0; c < chunks; c++) bin_chunk_task(&job, c, 0);
+    }
+
+    // 各组在图块列表中的写入位置按组的顺序排列
+    for (int tile = 0; tile < tiles; tile++) {
+        raster_bin_t* bin = &g_bins[tile];
+        int total = bin->count;
+        for (int c = 0; c < chunks; c++) {
+            int* count = &job.tile_counts[(size_t)c * tiles + tile];
+            int start = total;
+            total += *count;
+            *count = start;
+        }
+        if (total == bin->count) continue;
+        if (bin_reserve(bin, total)) {
+            bin->count = total;
+        } else {
+            for (int c = 0; c < chunks; c++) job.tile_counts[(size_t)c * tiles + tile] = -1;
+        }
+    }
+
+    if (parallel) {
+        thread_pool_run(g_raster_pool, chunks, bin_scatter_task, &job);
+    } else {
+        for (int c = 0; c < chunks; c++) bin_scatter_task(&job, c, 0);
+    }
+    PROFILE_END(PROFILE_STAGE_BIN);
+}
+
+// 光栅化一个图块：清除图块内的深度（没有三角形的图块也清除，供draw_line_depth使用），再按提交顺序绘制装箱的三角形（带深度测试，可开关，支持描边）
+static void raster_tile_task(void* ctx, int task_index, int worker_index) {
+    (void)ctx;
+    (void)worker_index;
+    PROFILE_BEGIN(PROFILE_STAGE_RASTERIZE_TILE);
+    int x0 = task_index % g_tiles_x * RASTER_TILE;
+    int y0 = task_index / g_tiles_x * RASTER_TILE;
+    int x1 = x0 + RASTER_TILE - 1 < window_width - 1 ? x0 + RASTER_TILE - 1 : window_width - 1;
+    int y1 = y0 + RASTER_TILE - 1 < window_height - 1 ? y0 + RASTER_TILE - 1 : window_height - 1;
+    const raster_bin_t* bin = &g_bins[task_index];
+    raster_counts_t counts = {0, 0};
+
+    bool use_hiz = g_enable_depth_test && g_enable_hierarchical_z;
+    if (g_enable_depth_test) {
+        for (int y = y0; y <= y1; y++) {
+            float* row = depth_buffer + (size_t)window_width * y;
+            for (int x = x0; x <= x1; x++) row[x] = -INFINITY;
+        }
+        for (int by = y0 / RASTER_BLOCK; by <= y1 / RASTER_BLOCK; by++) {
+            for (int bx = x0 / RASTER_BLOCK; bx <= x1 / RASTER_BLOCK; bx++) {
+                hiz_min[(size_t)hiz_width * by + bx] = -INFINITY;
+                hiz_max[(size_t)hiz_width * by + bx] = -INFINITY;
+            }
+        }
+    }
+    // 图块级的层次深度：图块内所有块最小值中的最小值，写入深度后再按需重新计算
+    float tile_min = -INFINITY;
+    bool tile_min_dirty = false;
+    for (int i = 0; i < bin->count; i++) {
+        const raster_triangle_t* t = &g_triangles[bin->items[i]];
+        bool visible = t->fill;
+        int rx0 = x0 > t->x0 ? x0 : t->x0, ry0 = y0 > t->y0 ? y0 : t->y0;
+        int rx1 = x1 < t->x1 ? x1 : t->x1, ry1 = y1 < t->y1 ? y1 : t->y1;
+        // 只覆盖少数几个块的小三角形直接用块级层次深度，省去重新计算图块最小值
+        bool large = (rx1 - rx0) * (ry1 - ry0) > 4 * RASTER_BLOCK * RASTER_BLOCK;
+        if (visible && use_hiz && large) {
+            if (tile_min_dirty) {
+                tile_min = INFINITY;
+                for (int by = y0 / RASTER_BLOCK; by <= y1 / RASTER_BLOCK; by++) {
+                    for (int bx = x0 / RASTER_BLOCK; bx <= x1 / RASTER_BLOCK; bx++) {
+                        tile_min = min_f(tile_min, hiz_min[(size_t)hiz_width * by + bx]);
                     }
-                    izval += izstep;
                 }
+                tile_min_dirty = false;
+            }
+            float z_lo, z_hi;
+            triangle_depth_range(t, rx0, ry0, rx1, ry1, &z_lo, &z_hi);
+            if (z_hi <= tile_min) {
+                PROFILE_COUNT(PROFILE_COUNTER_HIZ_TILES_REJECTED, 1);
+                visible = false;
             }
         }
+        if (visible && rasterize_triangle(t, x0, y0, x1, y1, &counts)) tile_min_dirty = true;
         // 三角形描边
-        if (g_enable_triangle_outline) {
-            // 取较暗色
-            uint32_t outline_color = (tri.color & 0xFF000000) | (((((tri.color>>16)&0xFF)*3/4)<<16) | ((((tri.color>>8)&0xFF)*3/4)<<8) | (((tri.color)&0xFF)*3/4));
-            draw_wireframe_triangle(p0, p1, p2, outline_color);
+        if (t->outline) {
+            const vec2_t* p = t->outline_points;
+            raster_line(p[0], 0.0f, p[1], 0.0f, t->outline_color, NULL, x0, y0, x1, y1);
+            raster_line(p[1], 0.0f, p[2], 0.0f, t->outline_color, NULL, x0, y0, x1, y1);
+            raster_line(p[0], 0.0f, p[2], 0.0f, t->outline_color, NULL, x0, y0, x1, y1);
         }
     }
+    g_tile_counts[task_index] = counts;
+    PROFILE_END(PROFILE_STAGE_RASTERIZE_TILE);
+}
+
+// 并行光栅化本帧装箱的所有三角形
+static void flush_bins(void) {
+    PROFILE_BEGIN(PROFILE_STAGE_RASTERIZE);
+    int tile_count = g_tiles_x * g_tiles_y;
+    thread_pool_run(g_raster_pool, tile_count, raster_tile_task, NULL);
+    raster_counts_t counts = {0, 0};
+    for (int i = 0; i < tile_count; i++) {
+        counts.fragments += g_tile_counts[i].fragments;
+        counts.pixels += g_tile_counts[i].pixels;
+    }
+    g_stats.pixels += counts.pixels;
+    PROFILE_COUNT(PROFILE_COUNTER_FRAGMENTS_TESTED, counts.fragments);
+    PROFILE_COUNT(PROFILE_COUNTER_DEPTH_FAILED, counts.fragments - counts.pixels);
+    PROFILE_END(PROFILE_STAGE_RASTERIZE);
 }
 
 #pragma endregion
 
 void render_scene(const camera_t camera, const instance_t *instances, int instance_count) {
+    // 深度缓冲区每帧只清除一次（在各图块的光栅化任务中），不同模型之间正确遮挡
+    g_depth_valid = false;
+    if (g_enable_depth_test && !ensure_depth_buffer(window_width, window_height)) return;
+    if (!begin_binning()) return;
+    // 本帧的属性组合、光照方式和着色方式，光栅化期间不再改变
+    // 内置着色（包括开启光照的平面着色）按光照方式补上需要的属性，自定义着色函数缺少这些属性时不计算光照
+    bool builtin = !g_shader_enabled || !g_shader.shade;
+    int varyings = g_shader_enabled ? g_shader.varyings : 0;
+    raster_lighting_mode_t lighting = g_lighting_mode;
+    int required = RASTER_VARYING_COLOR | (lighting == RASTER_LIGHTING_PIXEL ? RASTER_VARYING_NORMAL : 0);
+    if (lighting != RASTER_LIGHTING_OFF && builtin) varyings |= required;
+    if ((varyings & required) != required) lighting = RASTER_LIGHTING_OFF;
+    g_frame_varyings = varyings;
+    g_frame_lighting_mode = lighting;
+    g_frame_shaded_block = g_shader_enabled || lighting != RASTER_LIGHTING_OFF
+        ? g_shaded_blocks[lighting == RASTER_LIGHTING_PIXEL][raster_varying_count(varyings)]
+                         [builtin ? SHADE_BUILTIN : g_shader.derivatives ? SHADE_QUAD : SHADE_PIXEL]
+        : NULL;
+    // 上一帧的变换和裁剪结果已经装箱完毕，整体回收
+    arena_reset(&g_frame_arena);
+
+    // 裁剪平面：相机的平面（第0个为近平面），再加上保护带的四个侧面
+    // 保护带平面总是做几何裁剪，保证投影后的定点坐标在光栅化的精度范围内（相机可能没有侧面）；
+    // 保护带模式只有近平面和保护带平面做几何裁剪，其余平面只用于整体丢弃
+    int camera_plane_count = camera.clipping_plane_count;
+    if (camera_plane_count > CLIP_MAX_PLANES - 4) camera_plane_count = CLIP_MAX_PLANES - 4;
+    plane_t* planes = arena_alloc(&g_frame_arena, sizeof(plane_t) * (camera_plane_count + 4));
+    if (!planes) return;
+    if (camera_plane_count > 0) memcpy(planes, camera.clipping_planes, sizeof(plane_t) * camera_plane_count);
+    int plane_count = camera_plane_count;
+    // 屏幕坐标sx = w/2 + x / z * w，保护带|sx - w/2| <= GUARD_BAND_PIXELS即|x| <= gx * z
+    float gx = (float)GUARD_BAND_PIXELS / window_width;
+    float gy = (float)GUARD_BAND_PIXELS / window_height;
+    float nx = 1.0f / sqrtf(1.0f + gx * gx), ny = 1.0f / sqrtf(1.0f + gy * gy);
+    planes[plane_count++] = (plane_t){ { -nx, 0, gx * nx }, 0 };
+    planes[plane_count++] = (plane_t){ { nx, 0, gx * nx }, 0 };
+    planes[plane_count++] = (plane_t){ { 0, -ny, gy * ny }, 0 };
+    planes[plane_count++] = (plane_t){ { 0, ny, gy * ny }, 0 };
+    uint32_t clip_mask = plane_count < 32 ? (1u << plane_count) - 1 : ~0u;
+    if (g_enable_guard_band) clip_mask = (camera_plane_count > 0 ? 1u : 0u) | (0xFu << camera_plane_count);
+
     // 1. 计算相机变换矩阵
-    matrix_t camera_matrix = matrix_mul(
-        matrix_transpose(camera.orientation),
-        matrix_make_translation(vec3_neg(camera.position))
+    mat4_t camera_matrix = mat4_mul(
+        mat4_transpose(camera.orientation),
+        mat4_make_translation(vec3_neg(camera.position))
     );
+    // 光源变换到相机空间
+    if (lighting != RASTER_LIGHTING_OFF) {
+        lighting_prepare(&g_frame_lighting, g_lights, g_light_count, &camera_matrix, g_light_specular);
+    }
 
     for (int i = 0; i < instance_count; i++) {
+        g_stats.triangles += instances[i].model->triangle_count;
+        PROFILE_COUNT(PROFILE_COUNTER_TRIANGLES_IN, instances[i].model->triangle_count);
         // 2. 计算模型变换矩阵
-        matrix_t model_matrix = matrix_mul(
-            matrix_make_translation(instances[i].position),
-            matrix_mul(instances[i].orientation, matrix_make_scaling(instances[i].scale))
+        PROFILE_BEGIN(PROFILE_STAGE_SETUP);
+        mat4_t model_matrix = mat4_compose(
+            instances[i].position, instances[i].orientation, instances[i].scale
         );
-        matrix_t transform = matrix_mul(camera_matrix, model_matrix);
+        mat4_t transform = mat4_mul(camera_matrix, model_matrix);
 
-        // 3. 变换并裁剪
-        model_t* clipped = transform_and_clip(
-            camera.clipping_planes, camera.clipping_plane_count,
+        // 3. 包围球剔除：完全在视锥外的实例直接跳过，只检查与包围球相交的平面
+        uint32_t active_mask;
+        bool visible = classify_bounds(instances[i].model, &transform, planes, plane_count, &active_mask);
+        PROFILE_END(PROFILE_STAGE_SETUP);
+        if (!visible) {
+            PROFILE_COUNT(PROFILE_COUNTER_INSTANCES_CULLED, 1);
+            continue;
+        }
+
+        // 4. 变换并裁剪
+        transformed_model_t* clipped = transform_and_clip(
+            &g_frame_arena, g_raster_pool, g_enable_triangle_outline,
+            lighting == RASTER_LIGHTING_VERTEX ? &g_frame_lighting : NULL, planes, plane_count, active_mask, clip_mask,
             instances[i].model, &transform
         );
         if (clipped) {
-            // 4. 投影并光栅化
-            render_filled_model(clipped);
-            // 释放clipped分配的内存
-            free(clipped->vertexes);
-            free(clipped->triangles);
-            free(clipped);
+            // 5. 投影并装箱
+            bin_filled_model(clipped);
         }
     }
-}
\ No newline at end of file
+
+    // 6. 分块并行光栅化
+    flush_bins();
+    g_depth_valid = g_enable_depth_test;
+}
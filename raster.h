@@ -3,11 +3,18 @@
 
 #include "vector.h"
 #include "geometry.h"
+#include "thread_pool.h"
+#include "lighting.h"
 #include <stdint.h>
 
-// 画线函数，color为ARGB格式
+// 画线函数，color为ARGB格式；线段先按画布范围裁剪，任意长度
 void draw_line(vec2_t p0, vec2_t p1, uint32_t color);
 
+// 带深度测试的画线，z0/z1为端点的1/z（与深度缓冲区相同，大者更近）
+// 与上一次render_scene留下的深度比较，只画不被遮挡的像素，不写入深度
+// 上一次render_scene关闭了深度测试或没有深度缓冲区时与draw_line相同
+void draw_line_depth(vec2_t p0, float z0, vec2_t p1, float z1, uint32_t color);
+
 // 绘制线框三角形，color为ARGB格式
 void draw_wireframe_triangle(vec2_t p0, vec2_t p1, vec2_t p2, uint32_t color);
 
@@ -35,7 +42,77 @@ void interpolate(int i0, int d0, int i1, int d1, int* out, int* out_len);
 void set_depth_test_enabled(bool enabled);
 void set_backface_cull_enabled(bool enabled);
 void set_triangle_outline_enabled(bool enabled);
+// 层次深度（按8x8像素块和图块记录深度范围，提前剔除被遮挡的部分），默认开启，结果与关闭时一致
+void set_hierarchical_z_enabled(bool enabled);
+// 保护带裁剪：只有近平面（camera.clipping_planes[0]）和保护带的四个侧面做几何裁剪，屏幕外的部分交给光栅化按屏幕范围处理，默认开启
+// 关闭时相机的所有平面都做几何裁剪；保护带平面总是参与裁剪，以保证光栅化的定点数不溢出
+void set_guard_band_enabled(bool enabled);
+
+// 顶点属性插值（varyings）：按COLOR、NORMAL、UV的顺序紧凑排列，只包含着色器需要的属性
+// COLOR为r, g, b（0~1），NORMAL为相机空间的法向量（未归一化），UV为纹理坐标
+// 模型没有对应属性时，颜色取三角形颜色，法向量取面法向量，纹理坐标取0
+#define RASTER_VARYING_COLOR  1
+#define RASTER_VARYING_NORMAL 2
+#define RASTER_VARYING_UV     4
+#define RASTER_MAX_VARYINGS   8
+
+// 片元着色函数的输入
+typedef struct fragment {
+    const float* varyings;      // 透视校正插值后的属性
+    // 属性在屏幕x、y方向上每像素的变化量，由2x2像素组内相邻像素的差得到（组内共用）
+    // 着色器未开启derivatives时为NULL
+    const float* ddx;
+    const float* ddy;
+    int varying_count;
+    int varying_flags;          // 属性的组合（RASTER_VARYING_*）
+    int x, y;                   // 像素的屏幕坐标
+} fragment_t;
+
+// 片元着色函数：color为三角形颜色，返回ARGB颜色
+// 在光栅化线程上并行调用，不能修改共享状态
+typedef uint32_t (*fragment_shader_t)(const fragment_t* fragment, uint32_t color, const void* uniforms);
+
+typedef struct {
+    int varyings;               // 需要插值的属性，RASTER_VARYING_*的组合
+    fragment_shader_t shade;    // NULL时使用内置的顶点颜色着色（需要RASTER_VARYING_COLOR）
+    const void* uniforms;       // 原样传给shade
+    // 按2x2像素组光栅化并计算属性的屏幕导数（如纹理选择mip级别），组内三角形外的像素也计算属性
+    bool derivatives;
+} raster_shader_t;
+
+// 设置render_scene的着色方式（复制*shader），NULL时恢复为三角形颜色的平面着色（默认）
+// 深度测试开关、属性数量和着色函数的每种组合对应一个专门生成的内层循环
+void set_raster_shader(const raster_shader_t* shader);
+// 返回varyings中各属性的个数之和
+int raster_varying_count(int varyings);
+
+// 光照：与光线追踪使用相同的光源模型（lighting.h），不投射阴影
+// 光照强度乘到COLOR属性上（没有顶点颜色时为三角形颜色）
+// 平面着色时改用内置的顶点颜色着色；自定义着色函数须在varyings中包含COLOR
+// （逐像素光照还须包含NORMAL），从COLOR属性得到光照后的颜色，否则不受光照影响
+typedef enum {
+    RASTER_LIGHTING_OFF,        // 不计算光照（默认）
+    RASTER_LIGHTING_VERTEX,     // Gouraud：每个变换后的顶点按SIMD批量求一次强度，在三角形内插值
+    RASTER_LIGHTING_PIXEL       // 逐像素：插值法向量，每个像素求一次强度
+} raster_lighting_mode_t;
+
+// lights为世界空间的光源（复制，最多LIGHTING_MAX_LIGHTS个），render_scene按相机变换到相机空间；specular为镜面指数，-1表示没有镜面反射
+// 模型没有顶点法向量时用面法向量（逐顶点光照在三角形的三个顶点上分别计算）
+void set_raster_lighting(raster_lighting_mode_t mode, const light_t* lights, int light_count, float specular);
+
+// render_scene按64x64图块在线程池上并行光栅化，pool为NULL（默认）时在调用线程串行执行
+// 结果与线程数无关
+void set_raster_thread_pool(thread_pool_t* pool);
 
 void render_scene(const camera_t camera, const instance_t* instances, int instance_count);
 
+// 光栅化统计：提交给render_scene的三角形数，以及通过深度测试写入的像素数
+typedef struct {
+    uint64_t triangles;
+    uint64_t pixels;
+} raster_stats_t;
+
+raster_stats_t raster_get_stats(void);
+void raster_reset_stats(void);
+
 #endif // RASTER_H 
\ No newline at end of file
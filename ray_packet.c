@@ -0,0 +1,182 @@
+#include "ray_packet.h"
+#include <stdlib.h>
+#include <math.h>
+
+void sphere_soa_free(sphere_soa_t* soa) {
+    if (soa->cx) free(soa->cx);
+    soa->cx = soa->cy = soa->cz = soa->r2 = NULL;
+    soa->count = 0;
+    soa->padded_count = 0;
+}
+
+bool sphere_soa_resize(sphere_soa_t* soa, int slot_count) {
+    int padded = (slot_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    if (padded != soa->padded_count) {
+        sphere_soa_free(soa);
+        if (padded == 0) return true;
+        // 四个数组放在同一块对齐内存中
+        float* data = aligned_alloc(SIMD_ALIGN, sizeof(float) * 4 * padded);
+        if (!data) return false;
+        soa->cx = data;
+        soa->cy = data + padded;
+        soa->cz = data + padded * 2;
+        soa->r2 = data + padded * 3;
+        soa->padded_count = padded;
+    }
+    soa->count = slot_count;
+    for (int i = 0; i < padded; i++) {
+        sphere_soa_set(soa, i, NULL);
+    }
+    return true;
+}
+
+void sphere_soa_set(sphere_soa_t* soa, int slot, const sphere_t* sphere) {
+    if (sphere) {
+        soa->cx[slot] = sphere->center.x;
+        soa->cy[slot] = sphere->center.y;
+        soa->cz[slot] = sphere->center.z;
+        soa->r2[slot] = sphere->radius * sphere->radius;
+    } else {
+        soa->cx[slot] = soa->cy[slot] = soa->cz[slot] = 0.0f;
+        soa->r2[slot] = -INFINITY;
+    }
+}
+
+bool sphere_soa_build(sphere_soa_t* soa, const sphere_t* spheres, int count) {
+    if (!sphere_soa_resize(soa, count)) return false;
+    for (int i = 0; i < count; i++) {
+        sphere_soa_set(soa, i, &spheres[i]);
+    }
+    return true;
+}
+
+// 求一组光线与一组球体的最近有效交点，无效时为INFINITY
+// 与intersect_ray_sphere使用相同的运算顺序：b=dot(co,d)，disc=b*b-k1*c，t=(-b±sqrt(disc))/k1
+static inline simd_float hit_distance(
+    simd_float ox, simd_float oy, simd_float oz,
+    simd_float dx, simd_float dy, simd_float dz, simd_float inv_k1, simd_float k1,
+    simd_float cx, simd_float cy, simd_float cz, simd_float r2,
+    simd_float min_t, simd_float max_t
+) {
+    simd_float zero = simd_set1(0.0f);
+    simd_float cox = simd_sub(ox, cx);
+    simd_float coy = simd_sub(oy, cy);
+    simd_float coz = simd_sub(oz, cz);
+    simd_float b = simd_add(simd_add(simd_mul(cox, dx), simd_mul(coy, dy)), simd_mul(coz, dz));
+    simd_float c = simd_sub(simd_add(simd_add(simd_mul(cox, cox), simd_mul(coy, coy)), simd_mul(coz, coz)), r2);
+    simd_float disc = simd_sub(simd_mul(b, b), simd_mul(k1, c));
+    simd_mask hit = simd_cmple(zero, disc);
+    simd_float s = simd_sqrt(simd_max(disc, zero));
+    simd_float nb = simd_sub(zero, b);
+    simd_float t_near = simd_mul(simd_sub(nb, s), inv_k1);
+    simd_float t_far = simd_mul(simd_add(nb, s), inv_k1);
+    simd_mask near_ok = simd_mask_and(hit, simd_mask_and(simd_cmplt(min_t, t_near), simd_cmplt(t_near, max_t)));
+    simd_mask far_ok = simd_mask_and(hit, simd_mask_and(simd_cmplt(min_t, t_far), simd_cmplt(t_far, max_t)));
+    simd_float inf = simd_set1(INFINITY);
+    return simd_select(near_ok, t_near, simd_select(far_ok, t_far, inf));
+}
+
+int sphere_soa_closest_range(const sphere_soa_t* soa, int begin, int end,
+                             vec3_t origin, vec3_t direction, float min_t, float* inout_t) {
+    simd_float ox = simd_set1(origin.x), oy = simd_set1(origin.y), oz = simd_set1(origin.z);
+    simd_float dx = simd_set1(direction.x), dy = simd_set1(direction.y), dz = simd_set1(direction.z);
+    // k1也用向量运算求得，避免编译器对标量表达式做FMA收缩导致与光线包结果不一致
+    simd_float vk1 = simd_add(simd_add(simd_mul(dx, dx), simd_mul(dy, dy)), simd_mul(dz, dz));
+    simd_float inv_k1 = simd_div(simd_set1(1.0f), vk1);
+    simd_float vmin = simd_set1(min_t);
+
+    _Alignas(SIMD_ALIGN) float ts[SIMD_WIDTH];
+    float best_t = *inout_t;
+    int best = -1;
+    for (int i = begin; i < end; i += SIMD_WIDTH) {
+        simd_float t = hit_distance(ox, oy, oz, dx, dy, dz, inv_k1, vk1,
+                                    simd_load(soa->cx + i), simd_load(soa->cy + i),
+                                    simd_load(soa->cz + i), simd_load(soa->r2 + i),
+                                    vmin, simd_set1(best_t));
+        if (simd_mask_bits(simd_cmplt(t, simd_set1(best_t))) == 0) continue;
+        simd_store(ts, t);
+        // 按槽位顺序严格比较，距离相同时保留编号较小的球体
+        for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+            if (ts[lane] < best_t) {
+                best_t = ts[lane];
+                best = i + lane;
+            }
+        }
+    }
+    *inout_t = best_t;
+    return best;
+}
+
+bool sphere_soa_any_range(const sphere_soa_t* soa, int begin, int end,
+                          vec3_t origin, vec3_t direction, float min_t, float max_t) {
+    simd_float ox = simd_set1(origin.x), oy = simd_set1(origin.y), oz = simd_set1(origin.z);
+    simd_float dx = simd_set1(direction.x), dy = simd_set1(direction.y), dz = simd_set1(direction.z);
+    simd_float vk1 = simd_add(simd_add(simd_mul(dx, dx), simd_mul(dy, dy)), simd_mul(dz, dz));
+    simd_float inv_k1 = simd_div(simd_set1(1.0f), vk1);
+    simd_float vmin = simd_set1(min_t), vmax = simd_set1(max_t);
+    simd_float inf = simd_set1(INFINITY);
+    for (int i = begin; i < end; i += SIMD_WIDTH) {
+        simd_float t = hit_distance(ox, oy, oz, dx, dy, dz, inv_k1, vk1,
+                                    simd_load(soa->cx + i), simd_load(soa->cy + i),
+                                    simd_load(soa->cz + i), simd_load(soa->r2 + i),
+                                    vmin, vmax);
+        if (simd_mask_bits(simd_cmplt(t, inf)) != 0) return true;
+    }
+    return false;
+}
+
+int sphere_soa_closest(const sphere_soa_t* soa, vec3_t origin, vec3_t direction,
+                       float min_t, float max_t, float* out_t) {
+    float t = max_t;
+    int best = sphere_soa_closest_range(soa, 0, soa->padded_count, origin, direction, min_t, &t);
+    *out_t = best >= 0 ? t : INFINITY;
+    return best;
+}
+
+void ray_packet_closest_range(const sphere_soa_t* soa, int begin, int end,
+                              const ray_packet_t* packet, float min_t, ray_packet_hit_t* hit) {
+    simd_float ox = simd_load(packet->ox), oy = simd_load(packet->oy), oz = simd_load(packet->oz);
+    simd_float dx = simd_load(packet->dx), dy = simd_load(packet->dy), dz = simd_load(packet->dz);
+    simd_float k1 = simd_add(simd_add(simd_mul(dx, dx), simd_mul(dy, dy)), simd_mul(dz, dz));
+    simd_float inv_k1 = simd_div(simd_set1(1.0f), k1);
+    simd_float vmin = simd_set1(min_t);
+
+    _Alignas(SIMD_ALIGN) float best_index[RAY_PACKET_SIZE];
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        best_index[lane] = (float)hit->index[lane];
+    }
+    simd_float best_t = simd_load(hit->t);
+    simd_float best_i = simd_load(best_index);
+    bool improved = false;
+    for (int i = begin; i < end; i++) {
+        // 补齐的空槽位不参与计算
+        if (soa->r2[i] < 0) continue;
+        simd_float t = hit_distance(ox, oy, oz, dx, dy, dz, inv_k1, k1,
+                                    simd_set1(soa->cx[i]), simd_set1(soa->cy[i]),
+                                    simd_set1(soa->cz[i]), simd_set1(soa->r2[i]),
+                                    vmin, best_t);
+        simd_mask closer = simd_cmplt(t, best_t);
+        if (simd_mask_bits(closer) == 0) continue;
+        best_t = simd_select(closer, t, best_t);
+        best_i = simd_select(closer, simd_set1((float)i), best_i);
+        improved = true;
+    }
+    if (!improved) return;
+    simd_store(hit->t, best_t);
+    simd_store(best_index, best_i);
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        hit->index[lane] = (int)best_index[lane];
+    }
+}
+
+void ray_packet_closest(const sphere_soa_t* soa, const ray_packet_t* packet,
+                        float min_t, float max_t, ray_packet_hit_t* hit) {
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        hit->t[lane] = max_t;
+        hit->index[lane] = -1;
+    }
+    ray_packet_closest_range(soa, 0, soa->count, packet, min_t, hit);
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        if (hit->index[lane] < 0) hit->t[lane] = INFINITY;
+    }
+}
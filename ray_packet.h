@@ -0,0 +1,71 @@
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include <stdbool.h>
+#include "simd.h"
+#include "vector.h"
+#include "raytracer.h"
+
+// 每个光线包包含的光线数量，与SIMD宽度一致（4/8/16）
+#define RAY_PACKET_SIZE SIMD_WIDTH
+
+// 球体的SoA存储，数组长度按SIMD_WIDTH补齐
+// 补齐部分的r2为-INFINITY，判别式恒为负，永不相交
+typedef struct {
+    float* cx;
+    float* cy;
+    float* cz;
+    float* r2;          // 半径的平方
+    int count;          // 实际球体数量
+    int padded_count;   // 补齐后的数量
+} sphere_soa_t;
+
+// 一组相干光线，按SoA排列
+typedef struct {
+    _Alignas(SIMD_ALIGN) float ox[RAY_PACKET_SIZE];
+    _Alignas(SIMD_ALIGN) float oy[RAY_PACKET_SIZE];
+    _Alignas(SIMD_ALIGN) float oz[RAY_PACKET_SIZE];
+    _Alignas(SIMD_ALIGN) float dx[RAY_PACKET_SIZE];
+    _Alignas(SIMD_ALIGN) float dy[RAY_PACKET_SIZE];
+    _Alignas(SIMD_ALIGN) float dz[RAY_PACKET_SIZE];
+} ray_packet_t;
+
+// 光线包的求交结果，index为-1表示未命中
+typedef struct {
+    _Alignas(SIMD_ALIGN) float t[RAY_PACKET_SIZE];
+    int index[RAY_PACKET_SIZE];
+} ray_packet_hit_t;
+
+// 由AoS球体数组生成SoA存储，soa原有内存会被释放；内存不足时soa为空并返回false
+bool sphere_soa_build(sphere_soa_t* soa, const sphere_t* spheres, int count);
+// 分配slot_count个槽位（按SIMD_WIDTH补齐），所有槽位初始为空；内存不足时soa为空并返回false
+bool sphere_soa_resize(sphere_soa_t* soa, int slot_count);
+// 写入一个槽位，sphere为NULL时清空该槽位
+void sphere_soa_set(sphere_soa_t* soa, int slot, const sphere_t* sphere);
+void sphere_soa_free(sphere_soa_t* soa);
+
+// 单条光线与全部球体求交，各SIMD通道对应不同球体
+// 返回(min_t, max_t)内最近球体的编号并写入out_t，无交点时返回-1
+int sphere_soa_closest(const sphere_soa_t* soa, vec3_t origin, vec3_t direction,
+                       float min_t, float max_t, float* out_t);
+
+// 单条光线与[begin, end)槽位求交，begin和end须按SIMD_WIDTH对齐
+// *inout_t为当前最近距离（开区间上界），找到更近的交点时更新并返回槽位编号，否则返回-1
+int sphere_soa_closest_range(const sphere_soa_t* soa, int begin, int end,
+                             vec3_t origin, vec3_t direction, float min_t, float* inout_t);
+
+// 遮挡查询：[begin, end)槽位中存在(min_t, max_t)内的交点即返回true，不求最近交点
+bool sphere_soa_any_range(const sphere_soa_t* soa, int begin, int end,
+                          vec3_t origin, vec3_t direction, float min_t, float max_t);
+
+// 光线包与全部球体求交，各SIMD通道对应不同光线
+// 结果与对每条光线分别调用sphere_soa_closest逐位一致
+void ray_packet_closest(const sphere_soa_t* soa, const ray_packet_t* packet,
+                        float min_t, float max_t, ray_packet_hit_t* hit);
+
+// 光线包与[begin, end)槽位求交，hit->t为各光线当前最近距离（开区间上界）
+// 更近的交点会更新hit->t，并把hit->index设为槽位编号
+void ray_packet_closest_range(const sphere_soa_t* soa, int begin, int end,
+                              const ray_packet_t* packet, float min_t, ray_packet_hit_t* hit);
+
+#endif // RAY_PACKET_H
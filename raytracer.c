@@ -1,7 +1,16 @@
 #include "raytracer.h"
+#include "ray_packet.h"
+#include "sphere_bvh.h"
+#include "mesh_bvh.h"
 #include "display.h"
+#include "timing.h"
+#include "color.h"
+#include "profile.h"
 #include <math.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
 
 #ifndef min
 #define min(a, b) ((a) < (b) ? (a) : (b))
@@ -15,8 +24,47 @@
 // 全局变量定义
 sphere_t spheres[NUM_SPHERES];
 light_t lights[NUM_LIGHTS];
+const light_t default_lights[NUM_LIGHTS] = {
+    {LIGHT_AMBIENT, 0.2f, {0, 0, 0}},
+    {LIGHT_POINT, 0.6f, {2, 1, 0}},
+    {LIGHT_DIRECTIONAL, 0.2f, {1, 4, 4}}
+};
 vec3_t camera_position = {3, 0, 1};
-matrix_t camera_rotation;
+mat3_t camera_rotation;
+sphere_set_t scene_spheres;
+
+// 光线追踪场景中的三角形网格
+typedef struct {
+    mesh_bvh_t bvh;
+    float specular;
+    float reflective;
+} raytracer_mesh_t;
+
+static raytracer_mesh_t* scene_meshes = NULL;
+static int scene_mesh_count = 0;
+static int scene_mesh_capacity = 0;
+
+// 光线计数：各线程先累加到线程局部变量，图块结束时再合并，避免争用
+static _Atomic uint64_t total_ray_count = 0;
+static _Thread_local uint64_t thread_ray_count = 0;
+
+static void flush_ray_count(void) {
+    atomic_fetch_add_explicit(&total_ray_count, thread_ray_count, memory_order_relaxed);
+    thread_ray_count = 0;
+}
+
+uint64_t raytracer_ray_count(void) {
+    flush_ray_count();
+    return atomic_load_explicit(&total_ray_count, memory_order_relaxed);
+}
+
+void raytracer_reset_stats(void) {
+    thread_ray_count = 0;
+    atomic_store_explicit(&total_ray_count, 0, memory_order_relaxed);
+}
+
+// 场景版本号，场景改变时递增，渐进式预览据此判断累积结果是否失效
+static unsigned int scene_version = 0;
 
 // 向量点积
 float dot_product(vec3_t v1, vec3_t v2) {
@@ -67,34 +115,6 @@ vec3_t reflect_ray(vec3_t v1, vec3_t v2)
     return result;
 }
 
-// clamp函数：将颜色的每个分量限制在0到255之间
-uint32_t color_clamp(uint32_t color) {
-    uint8_t a = (color >> 24) & 0xFF;
-    uint8_t r = (color >> 16) & 0xFF;
-    uint8_t g = (color >> 8) & 0xFF;
-    uint8_t b = color & 0xFF;
-
-    r = min(255, max(0, r));
-    g = min(255, max(0, g));
-    b = min(255, max(0, b));
-
-    return (a << 24) | (r << 16) | (g << 8) | b;
-}
-
-
-uint32_t apply_lighting_to_color(uint32_t color, float lighting) {
-    uint8_t a = (color >> 24) & 0xFF;
-    uint8_t r = (color >> 16) & 0xFF;
-    uint8_t g = (color >> 8) & 0xFF;
-    uint8_t b = color & 0xFF;
-
-    r = min(255, (int)(r * lighting));
-    g = min(255, (int)(g * lighting));
-    b = min(255, (int)(b * lighting));
-
-    return (a << 24) | (r << 16) | (g << 8) | b;
-}
-
 // 将2D画布坐标转换为3D视口坐标
 vec3_t canvas_to_viewport(int x, int y) {
     vec3_t result = {
@@ -106,51 +126,101 @@ vec3_t canvas_to_viewport(int x, int y) {
 }
 
 // 计算光线与球体的相交
-intersection_result_t intersect_ray_sphere(vec3_t origin, vec3_t direction, sphere_t sphere) {
+// 使用半b形式的求根公式，只开一次平方根
+intersection_result_t intersect_ray_sphere(vec3_t origin, vec3_t direction, const sphere_t* sphere) {
     intersection_result_t result = {INFINITY, INFINITY};
     
-    vec3_t co = subtract(origin, sphere.center);
+    vec3_t co = subtract(origin, sphere->center);
     
     float k1 = dot_product(direction, direction);
-    float k2 = 2 * dot_product(co, direction);
-    float k3 = dot_product(co, co) - sphere.radius * sphere.radius;
+    float b = dot_product(co, direction);
+    float c = dot_product(co, co) - sphere->radius * sphere->radius;
     
-    float discriminant = k2 * k2 - 4 * k1 * k3;
+    float discriminant = b * b - k1 * c;
     if (discriminant < 0) {
         return result;
     }
     
-    result.t1 = (-k2 + sqrt(discriminant)) / (2 * k1);
-    result.t2 = (-k2 - sqrt(discriminant)) / (2 * k1);
+    float s = sqrtf(discriminant);
+    float inv_k1 = 1.0f / k1;
+    result.t1 = (-b + s) * inv_k1;
+    result.t2 = (-b - s) * inv_k1;
     
     return result;
 }
 
-closest_intersection_result_t closest_intersection(vec3_t origin, vec3_t direction, float min_t, float max_t)
-{
-    closest_intersection_result_t result = {NULL, INFINITY};
-    
-    for (int i = 0; i < NUM_SPHERES; i++) {
-        intersection_result_t ts = intersect_ray_sphere(origin, direction, spheres[i]);
-        
-        if (ts.t1 < result.t && min_t < ts.t1 && ts.t1 < max_t) {
-            result.t = ts.t1;
-            result.sphere = &spheres[i];
-        }
-        if (ts.t2 < result.t && min_t < ts.t2 && ts.t2 < max_t) {
-            result.t = ts.t2;
-            result.sphere = &spheres[i];
+int raytracer_add_model(const model_t* model, float specular, float reflective) {
+    if (scene_mesh_count == scene_mesh_capacity) {
+        int capacity = scene_mesh_capacity ? scene_mesh_capacity * 2 : 4;
+        raytracer_mesh_t* meshes = realloc(scene_meshes, sizeof(raytracer_mesh_t) * capacity);
+        if (!meshes) return -1;
+        scene_meshes = meshes;
+        scene_mesh_capacity = capacity;
+    }
+    raytracer_mesh_t* mesh = &scene_meshes[scene_mesh_count];
+    if (!mesh_bvh_build(&mesh->bvh, model)) return -1;
+    mesh->specular = specular;
+    mesh->reflective = reflective;
+    scene_version++;
+    return scene_mesh_count++;
+}
+
+void raytracer_clear_models(void) {
+    for (int i = 0; i < scene_mesh_count; i++) {
+        mesh_bvh_free(&scene_meshes[i].bvh);
+    }
+    scene_mesh_count = 0;
+    scene_version++;
+}
+
+// 在已有球体交点的基础上继续与三角形网格求交，只接受更近的交点
+static void closest_mesh_intersection(vec3_t origin, vec3_t direction, float min_t, float max_t,
+                                      closest_intersection_result_t* result) {
+    float t = result->sphere ? result->t : max_t;
+    for (int i = 0; i < scene_mesh_count; i++) {
+        int triangle = mesh_bvh_closest(&scene_meshes[i].bvh, origin, direction, min_t, &t);
+        if (triangle >= 0) {
+            result->sphere = NULL;
+            result->mesh = i;
+            result->triangle = triangle;
+            result->t = t;
         }
     }
+}
 
+closest_intersection_result_t closest_intersection(vec3_t origin, vec3_t direction, float min_t, float max_t)
+{
+    thread_ray_count++;
+    closest_intersection_result_t result = {NULL, -1, -1, INFINITY};
+    int index = sphere_set_closest(&scene_spheres, origin, direction, min_t, max_t, &result.t);
+    if (index >= 0) {
+        result.sphere = &scene_spheres.spheres[index];
+    }
+    closest_mesh_intersection(origin, direction, min_t, max_t, &result);
     return result;
 }
 
-// 计算光照
+// 遮挡查询，hint为球体BVH的遮挡叶子缓存
+static bool occluded(vec3_t origin, vec3_t direction, float min_t, float max_t, int* hint) {
+    thread_ray_count++;
+    PROFILE_COUNT(PROFILE_COUNTER_RAYS_SHADOW, 1);
+    if (sphere_set_occluded(&scene_spheres, origin, direction, min_t, max_t, hint)) return true;
+    for (int i = 0; i < scene_mesh_count; i++) {
+        if (mesh_bvh_occluded(&scene_meshes[i].bvh, origin, direction, min_t, max_t)) return true;
+    }
+    return false;
+}
+
+// 每个线程记录各光源上一次的遮挡叶子，相邻像素的阴影光线优先测试它
+// 存储的是叶子下标加1，使零初始化表示没有记录
+static _Thread_local int shadow_occluder_hint[NUM_LIGHTS];
+
+// 计算光照：光源模型与光栅化相同（lighting_light_term），只多了阴影测试
 float compute_lighting(vec3_t point, vec3_t normal, vec3_t view, float specular) {
     float intensity = 0.0f;
     float length_n = length(normal);
     float length_v = length(view);
+    lighting_specular_t material = lighting_specular_make(specular);
 
     for (int i = 0; i < NUM_LIGHTS; i++) {
         light_t light = lights[i];
@@ -168,71 +238,420 @@ float compute_lighting(vec3_t point, vec3_t normal, vec3_t view, float specular)
             }
 
             // 阴影检测：判断从点point沿vec_l方向是否有物体阻挡光线
-            // 阴影偏移，防止自遮挡
-            closest_intersection_result_t shadow = closest_intersection(point, vec_l, EPSILON, t_max);
-            if (shadow.sphere != NULL) {
+            // 阴影偏移，防止自遮挡；只需知道是否有遮挡，找到任意一个即可
+            int hint = shadow_occluder_hint[i] - 1;
+            bool blocked = occluded(point, vec_l, EPSILON, t_max, &hint);
+            shadow_occluder_hint[i] = hint + 1;
+            if (blocked) {
                 continue; // 有遮挡，跳过该光源
             }
 
-            // 漫反射
-            float n_dot_l = dot_product(normal, vec_l);
-            if (n_dot_l > 0) {
-                intensity += light.intensity * n_dot_l / (length_n * length(vec_l));
-            }
-
-            // 镜面反射
-            if (specular != -1) {
-                vec3_t vec_r = subtract(multiply(normal, 2 * dot_product(normal, vec_l)), vec_l);
-                float r_dot_v = dot_product(vec_r, view);
-                if (r_dot_v > 0) {
-                    intensity += light.intensity * pow(r_dot_v / (length(vec_r) * length_v), specular);
-                }
-            }   
+            // 漫反射和镜面反射
+            intensity += lighting_light_term(normal, length_n, vec_l, view, length_v, light.intensity, &material);
         }
     }
     return intensity;
 }
 
+// 交点处的表面属性
+typedef struct {
+    vec3_t point;
+    vec3_t normal;
+    uint32_t color;
+    float specular;
+    float reflective;
+} surface_t;
+
+static surface_t surface_at(vec3_t origin, vec3_t direction, const closest_intersection_result_t* hit) {
+    surface_t s;
+    s.point = add(origin, multiply(direction, hit->t));
+    if (hit->sphere) {
+        s.normal = normalize(subtract(s.point, hit->sphere->center));
+        s.color = hit->sphere->color;
+        s.specular = hit->sphere->specular;
+        s.reflective = hit->sphere->reflective;
+    } else {
+        const raytracer_mesh_t* mesh = &scene_meshes[hit->mesh];
+        const model_t* model = mesh->bvh.model;
+        triangle_t tri = model->triangles[hit->triangle];
+        vec3_t v0 = model->vertexes[tri.v0];
+        s.normal = normalize(vec3_cross(subtract(model->vertexes[tri.v1], v0), subtract(model->vertexes[tri.v2], v0)));
+        // 三角形双面可见，法线朝向光线来的一侧
+        if (dot_product(s.normal, direction) > 0) s.normal = vec3_neg(s.normal);
+        s.color = tri.color;
+        s.specular = mesh->specular;
+        s.reflective = mesh->reflective;
+    }
+    return s;
+}
+
+// 从已知的第一个交点开始，沿反射路径迭代着色（不递归）
+// throughput为当前光线对像素的贡献权重，每次反射乘以reflective，颜色全程保持浮点
+static color_t shade_hit(vec3_t origin, vec3_t direction, closest_intersection_result_t hit, int depth) {
+    color_t result = {0.0f, 0.0f, 0.0f, 1.0f};
+    float throughput = 1.0f;
+    for (;;) {
+        surface_t s = surface_at(origin, direction, &hit);
+        vec3_t view = multiply(direction, -1);
+        float lighting = compute_lighting(s.point, s.normal, view, s.specular);
+        color_t local_color = color_scale(color_from_argb(s.color), lighting);
+
+        if (s.reflective <= 0 || depth <= 0) {
+            return color_add_scaled(result, local_color, throughput);
+        }
+        // 本地颜色占(1 - reflective)，其余由反射光线决定
+        result = color_add_scaled(result, local_color, throughput * (1 - s.reflective));
+        throughput *= s.reflective;
+
+        // 计算反射光线
+        origin = s.point;
+        direction = reflect_ray(view, s.normal);
+        depth--;
+        PROFILE_COUNT(PROFILE_COUNTER_RAYS_REFLECTION, 1);
+        hit = closest_intersection(origin, direction, EPSILON, INFINITY);
+        if (hit.sphere == NULL && hit.mesh < 0) {
+            return color_add_scaled(result, color_from_argb(BACKGROUND_COLOR), throughput);
+        }
+    }
+}
+
 // 追踪光线
-uint32_t trace_ray(vec3_t origin, vec3_t direction, float min_t, float max_t, int depth) {
+color_t trace_ray(vec3_t origin, vec3_t direction, float min_t, float max_t, int depth) {
     closest_intersection_result_t result = closest_intersection(origin, direction, min_t, max_t);
-    sphere_t *closest_sphere = result.sphere;
-    float closest_t = result.t;
-    if (closest_sphere == NULL) {
-        return BACKGROUND_COLOR;
+    if (result.sphere == NULL && result.mesh < 0) {
+        return color_from_argb(BACKGROUND_COLOR);
     }
-    
-    vec3_t point = add(origin, multiply(direction, closest_t));
-    vec3_t normal = normalize(subtract(point, closest_sphere->center));
+    return shade_hit(origin, direction, result, depth);
+}
+
+// 一帧光线追踪的只读参数，在开始渲染前生成快照
+typedef struct {
+    vec3_t origin;
+    mat3_t rotation;
+    int tiles_x;
+    int tiles_y;
+} raytracer_frame_t;
+
+// 追踪画布坐标(x, y)处的主光线并打包，与render_tile的结果逐位一致
+static uint32_t trace_pixel(const raytracer_frame_t* frame, int x, int y) {
+    vec3_t direction = normalize(canvas_to_viewport(x, y));
+    direction = mat3_mul_vec3(&frame->rotation, direction);
+    PROFILE_COUNT(PROFILE_COUNTER_RAYS_PRIMARY, 1);
+    return color_pack(trace_ray(frame->origin, direction, 1, INFINITY, 3));
+}
 
-    vec3_t view = multiply(direction, -1);
-    float lighting = compute_lighting(point, normal, view, closest_sphere->specular);
-    uint32_t local_color = apply_lighting_to_color(closest_sphere->color, lighting);
+// 浮点HDR帧缓冲区，与color_buffer同尺寸，画面大小变化时重新分配
+static color_t* hdr_buffer = NULL;
+static int hdr_buffer_w = 0, hdr_buffer_h = 0;
+
+static bool ensure_hdr_buffer(void) {
+    if (hdr_buffer && hdr_buffer_w == window_width && hdr_buffer_h == window_height) return true;
+    free(hdr_buffer);
+    size_t bytes = sizeof(color_t) * (size_t)window_width * window_height;
+    hdr_buffer = aligned_alloc(64, (bytes + 63) / 64 * 64);
+    hdr_buffer_w = hdr_buffer ? window_width : 0;
+    hdr_buffer_h = hdr_buffer ? window_height : 0;
+    return hdr_buffer != NULL;
+}
 
-    if(closest_sphere->reflective <= 0 || depth <= 0)
-    {
-        return local_color;
+const color_t* raytracer_hdr_buffer(void) {
+    return hdr_buffer;
+}
+
+// 追踪一个图块，逐行写入hdr_buffer，整行追踪完后打包写入color_buffer
+static void render_tile(void* ctx, int tile_index, int worker_index) {
+    (void)worker_index;
+    PROFILE_BEGIN(PROFILE_STAGE_RAYTRACE_TILE);
+    const raytracer_frame_t* frame = (const raytracer_frame_t*)ctx;
+    int x0 = (tile_index % frame->tiles_x) * RAYTRACER_TILE_SIZE;
+    int y0 = (tile_index / frame->tiles_x) * RAYTRACER_TILE_SIZE;
+    int x1 = min(x0 + RAYTRACER_TILE_SIZE, window_width);
+    int y1 = min(y0 + RAYTRACER_TILE_SIZE, window_height);
+    // 与逐像素的画布坐标保持一致：x, y取值范围为[-w/2, w/2)，超出部分不绘制
+    int half_w = window_width / 2;
+    int half_h = window_height / 2;
+
+    // 每行按RAY_PACKET_SIZE个相邻像素组成光线包求主光线交点，再逐条着色
+    ray_packet_t packet;
+    ray_packet_hit_t hit;
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        packet.ox[lane] = frame->origin.x;
+        packet.oy[lane] = frame->origin.y;
+        packet.oz[lane] = frame->origin.z;
+    }
+    for (int row = y0; row < y1; row++) {
+        int y = half_h - row;
+        if (y < -half_h || y >= half_h) continue;
+        color_t* row_hdr = hdr_buffer + (size_t)window_width * row;
+        int col_begin = max(x0, 0);
+        int col_end = min(x1, half_w * 2);
+        for (int col = col_begin; col < col_end; col += RAY_PACKET_SIZE) {
+            int lanes = min(RAY_PACKET_SIZE, col_end - col);
+            vec3_t directions[RAY_PACKET_SIZE];
+            for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                // 多余的通道重复最后一条光线，结果丢弃
+                int x = col + min(lane, lanes - 1) - half_w;
+                vec3_t direction = normalize(canvas_to_viewport(x, y));
+                direction = mat3_mul_vec3(&frame->rotation, direction);
+                directions[lane] = direction;
+                packet.dx[lane] = direction.x;
+                packet.dy[lane] = direction.y;
+                packet.dz[lane] = direction.z;
+            }
+            sphere_set_closest_packet(&scene_spheres, &packet, 1, INFINITY, &hit);
+            thread_ray_count += lanes;
+            PROFILE_COUNT(PROFILE_COUNTER_RAYS_PRIMARY, lanes);
+            for (int lane = 0; lane < lanes; lane++) {
+                closest_intersection_result_t result = {NULL, -1, -1, INFINITY};
+                if (hit.index[lane] >= 0) {
+                    result.sphere = &scene_spheres.spheres[hit.index[lane]];
+                    result.t = hit.t[lane];
+                }
+                closest_mesh_intersection(frame->origin, directions[lane], 1, INFINITY, &result);
+                row_hdr[col + lane] = (result.sphere == NULL && result.mesh < 0)
+                    ? color_from_argb(BACKGROUND_COLOR)
+                    : shade_hit(frame->origin, directions[lane], result, 3);
+            }
+        }
+        // 一次性色调映射并打包，数据仍在缓存中
+        if (col_end > col_begin) {
+            color_pack_span(row_hdr + col_begin, color_buffer + (size_t)window_width * row + col_begin,
+                            col_end - col_begin);
+        }
+    }
+    flush_ray_count();
+    PROFILE_END(PROFILE_STAGE_RAYTRACE_TILE);
+}
+
+void raytracer_render_frame(thread_pool_t* pool) {
+    if (!ensure_hdr_buffer()) return;
+    PROFILE_BEGIN(PROFILE_STAGE_RAYTRACE);
+    raytracer_frame_t frame = {
+        .origin = camera_position,
+        .rotation = camera_rotation,
+        .tiles_x = (window_width + RAYTRACER_TILE_SIZE - 1) / RAYTRACER_TILE_SIZE,
+        .tiles_y = (window_height + RAYTRACER_TILE_SIZE - 1) / RAYTRACER_TILE_SIZE,
+    };
+    thread_pool_run(pool, frame.tiles_x * frame.tiles_y, render_tile, &frame);
+    PROFILE_END(PROFILE_STAGE_RAYTRACE);
+}
+
+#pragma region 渐进式预览
+
+// 第一遍每PREVIEW_COARSE_BLOCK x PREVIEW_COARSE_BLOCK个像素追踪一条光线（1/16分辨率）
+// 之后每次细化块大小减半，已有的采样点直接复用
+#define PREVIEW_COARSE_BLOCK 4
+
+typedef struct {
+    int block;          // 当前块大小，0表示尚未追踪，1表示已收敛
+    float variance;     // 当前采样的亮度方差，越大越优先细化
+} preview_tile_t;
+
+// 累积结果及其对应的场景/相机状态
+typedef struct {
+    uint32_t* pixels;
+    preview_tile_t* tiles;
+    int* order;                 // 细化顺序的临时数组
+    int width, height;
+    int tiles_x, tiles_y;
+    unsigned int scene_version;
+    vec3_t camera_position;
+    float camera_rotation[9];
+    bool valid;
+} preview_state_t;
+
+static preview_state_t preview;
+
+void raytracer_mark_scene_dirty(void) {
+    scene_version++;
+}
+
+static void snapshot_rotation(float out[9]) {
+    memcpy(out, camera_rotation.m, sizeof(float) * 9);
+}
+
+// 相机、场景或画面大小改变时丢弃累积结果，返回false表示内存不足
+static bool preview_prepare(void) {
+    float rotation[9];
+    snapshot_rotation(rotation);
+    if (preview.valid &&
+        preview.width == window_width && preview.height == window_height &&
+        preview.scene_version == scene_version &&
+        memcmp(&preview.camera_position, &camera_position, sizeof(vec3_t)) == 0 &&
+        memcmp(preview.camera_rotation, rotation, sizeof(rotation)) == 0) {
+        return true;
+    }
+
+    int tiles_x = (window_width + RAYTRACER_TILE_SIZE - 1) / RAYTRACER_TILE_SIZE;
+    int tiles_y = (window_height + RAYTRACER_TILE_SIZE - 1) / RAYTRACER_TILE_SIZE;
+    if (!preview.valid || preview.width != window_width || preview.height != window_height) {
+        free(preview.pixels);
+        free(preview.tiles);
+        free(preview.order);
+        preview.pixels = malloc(sizeof(uint32_t) * (size_t)window_width * window_height);
+        preview.tiles = malloc(sizeof(preview_tile_t) * tiles_x * tiles_y);
+        preview.order = malloc(sizeof(int) * tiles_x * tiles_y);
+        if (!preview.pixels || !preview.tiles || !preview.order) {
+            preview.valid = false;
+            return false;
+        }
+        preview.width = window_width;
+        preview.height = window_height;
+        preview.tiles_x = tiles_x;
+        preview.tiles_y = tiles_y;
+    }
+    for (size_t i = 0; i < (size_t)window_width * window_height; i++) {
+        preview.pixels[i] = BACKGROUND_COLOR;
+    }
+    for (int i = 0; i < tiles_x * tiles_y; i++) {
+        preview.tiles[i] = (preview_tile_t){0, 0.0f};
+    }
+    preview.scene_version = scene_version;
+    preview.camera_position = camera_position;
+    memcpy(preview.camera_rotation, rotation, sizeof(rotation));
+    preview.valid = true;
+    return true;
+}
+
+static float color_luminance(uint32_t color) {
+    return 0.299f * ((color >> 16) & 0xFF) + 0.587f * ((color >> 8) & 0xFF) + 0.114f * (color & 0xFF);
+}
+
+// 一遍细化的参数
+typedef struct {
+    raytracer_frame_t frame;
+    const int* tiles;
+} preview_pass_t;
+
+// 将图块细化一级：块大小减半，只追踪新增的采样点，并重新计算亮度方差
+static void refine_tile(void* ctx, int task_index, int worker_index) {
+    (void)worker_index;
+    PROFILE_BEGIN(PROFILE_STAGE_RAYTRACE_TILE);
+    const preview_pass_t* pass = (const preview_pass_t*)ctx;
+    int tile_index = pass->tiles[task_index];
+    preview_tile_t* tile = &preview.tiles[tile_index];
+    int prev_block = tile->block;
+    int block = prev_block ? prev_block / 2 : PREVIEW_COARSE_BLOCK;
+
+    int x0 = (tile_index % preview.tiles_x) * RAYTRACER_TILE_SIZE;
+    int y0 = (tile_index / preview.tiles_x) * RAYTRACER_TILE_SIZE;
+    int x1 = min(x0 + RAYTRACER_TILE_SIZE, preview.width);
+    int y1 = min(y0 + RAYTRACER_TILE_SIZE, preview.height);
+    int half_w = preview.width / 2;
+    int half_h = preview.height / 2;
+
+    float sum = 0.0f, sum_sq = 0.0f;
+    int samples = 0;
+    for (int by = y0; by < y1; by += block) {
+        for (int bx = x0; bx < x1; bx += block) {
+            // 与render_tile一致，画布坐标范围外的像素不追踪
+            bool inside = by > 0 && by <= 2 * half_h && bx < 2 * half_w;
+            uint32_t color;
+            if (prev_block && bx % prev_block == 0 && by % prev_block == 0 && (inside || block > 1)) {
+                // 上一级已经在此处采样，块内像素都已是该颜色
+                color = preview.pixels[(size_t)preview.width * by + bx];
+            } else {
+                if (inside) {
+                    color = trace_pixel(&pass->frame, bx - half_w, half_h - by);
+                } else if (block > 1) {
+                    // 粗糙级别用最近的有效像素代替
+                    int sx = min(bx, 2 * half_w - 1);
+                    int sy = max(by, 1);
+                    color = trace_pixel(&pass->frame, sx - half_w, half_h - sy);
+                } else {
+                    color = BACKGROUND_COLOR;
+                }
+                int ex = min(bx + block, x1);
+                int ey = min(by + block, y1);
+                for (int y = by; y < ey; y++) {
+                    uint32_t* row = preview.pixels + (size_t)preview.width * y;
+                    for (int x = bx; x < ex; x++) row[x] = color;
+                }
+            }
+            float l = color_luminance(color);
+            sum += l;
+            sum_sq += l * l;
+            samples++;
+        }
     }
-    // 计算反射光线
-    vec3_t reflected_ray = reflect_ray(view, normal);
+    float mean = sum / samples;
+    tile->variance = sum_sq / samples - mean * mean;
+    tile->block = block;
+    flush_ray_count();
+    PROFILE_END(PROFILE_STAGE_RAYTRACE_TILE);
+}
 
-    // 递归追踪反射光线
-    uint32_t reflected_color = trace_ray(point, reflected_ray, EPSILON, INFINITY, depth - 1);
+// 细化优先级：方差大、块大的图块优先，相同时按图块编号保证顺序确定
+static int compare_tile_priority(const void* a, const void* b) {
+    int ia = *(const int*)a, ib = *(const int*)b;
+    const preview_tile_t* ta = &preview.tiles[ia];
+    const preview_tile_t* tb = &preview.tiles[ib];
+    float pa = ta->variance * ta->block;
+    float pb = tb->variance * tb->block;
+    if (pa != pb) return pa < pb ? 1 : -1;
+    if (ta->block != tb->block) return ta->block < tb->block ? 1 : -1;
+    return ia - ib;
+}
 
-    // 反射与本地颜色混合
-    return color_clamp(apply_lighting_to_color(local_color, (1 - closest_sphere->reflective)) +
-            apply_lighting_to_color(reflected_color, closest_sphere->reflective));
+bool raytracer_render_progressive(thread_pool_t* pool, double budget_ms) {
+    double start = time_now_ms();
+    if (!preview_prepare()) {
+        raytracer_render_frame(pool);
+        return true;
+    }
+    PROFILE_BEGIN(PROFILE_STAGE_RAYTRACE);
+
+    preview_pass_t pass = {
+        .frame = {
+            .origin = camera_position,
+            .rotation = camera_rotation,
+            .tiles_x = preview.tiles_x,
+            .tiles_y = preview.tiles_y,
+        },
+        .tiles = preview.order,
+    };
+    int tile_count = preview.tiles_x * preview.tiles_y;
+    // 每批细化的图块数，批次之间检查时间预算
+    int batch = thread_pool_size(pool) * 2;
+    bool converged = false;
+
+    for (;;) {
+        int pending = 0, coarse = 0;
+        for (int i = 0; i < tile_count; i++) {
+            if (preview.tiles[i].block == 0) preview.order[coarse++] = i;
+        }
+        if (coarse > 0) {
+            // 低分辨率的第一遍总是完整执行，保证整个画面都有内容
+            thread_pool_run(pool, coarse, refine_tile, &pass);
+        } else {
+            for (int i = 0; i < tile_count; i++) {
+                if (preview.tiles[i].block > 1) preview.order[pending++] = i;
+            }
+            if (pending == 0) {
+                converged = true;
+                break;
+            }
+            qsort(preview.order, pending, sizeof(int), compare_tile_priority);
+            thread_pool_run(pool, min(pending, batch), refine_tile, &pass);
+        }
+        if (time_now_ms() - start >= budget_ms) break;
+    }
+
+    memcpy(color_buffer, preview.pixels, sizeof(uint32_t) * (size_t)window_width * window_height);
+    PROFILE_END(PROFILE_STAGE_RAYTRACE);
+    return converged;
 }
 
+#pragma endregion
+
 // 初始化场景
 void init_scene(void) {
-    // 使用给定的二维数组初始化相机旋转矩阵
-    float cam_rot_arr[3][3] = {
+    // 初始化相机旋转矩阵
+    camera_rotation = (mat3_t){{
         {0.7071f, 0.0f, -0.7071f},
         {0.0f,    1.0f,  0.0f   },
         {0.7071f, 0.0f,  0.7071f}
-    };
-    camera_rotation = matrix_from_2darray(3, 3, cam_rot_arr);
+    }};
     // 初始化球体
     spheres[0] = (sphere_t){{0, -1, 3}, 1, 0xFFFF0000, 500, 0.2};  // 红色球体
     spheres[1] = (sphere_t){{-2, 0, 4}, 1, 0xFF00FF00, 10, 0.4};  // 绿色球体
@@ -240,7 +659,18 @@ void init_scene(void) {
     spheres[3] = (sphere_t){{0, -5001, 0}, 5000, 0xFFFFFF00, 1000, 0.5};  // 黄色球体
 
     // 初始化光源
-    lights[0] = (light_t){LIGHT_AMBIENT, 0.2, {0, 0, 0}};
-    lights[1] = (light_t){LIGHT_POINT, 0.6, {2, 1, 0}};
-    lights[2] = (light_t){LIGHT_DIRECTIONAL, 0.2, {1, 4, 4}};
+    for (int i = 0; i < NUM_LIGHTS; i++) lights[i] = default_lights[i];
+
+    // 载入球体集合并构建BVH
+    sphere_set_clear(&scene_spheres);
+    for (int i = 0; i < NUM_SPHERES; i++) {
+        sphere_set_add(&scene_spheres, spheres[i]);
+    }
+    sphere_set_build(&scene_spheres);
+    scene_version++;
+}
+
+void raytracer_update_scene(void) {
+    sphere_set_refit(&scene_spheres);
+    scene_version++;
 } 
\ No newline at end of file
@@ -4,7 +4,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "vector.h"
-#include "matrix.h"
+#include "mat4.h"
+#include "geometry.h"
+#include "thread_pool.h"
+#include "color.h"
+#include "lighting.h"
 
 // 球体结构体
 typedef struct {
@@ -21,37 +25,32 @@ typedef struct {
 } intersection_result_t;
 
 typedef struct {
-    sphere_t *sphere;
+    const sphere_t *sphere;  // 命中球体时非NULL
+    int mesh;                // 命中三角形网格时为网格编号，否则为-1
+    int triangle;            // 命中的三角形在模型中的下标
     float t;
 } closest_intersection_result_t;
 
-// 光源类型
-enum light_type {
-    LIGHT_AMBIENT,
-    LIGHT_POINT,
-    LIGHT_DIRECTIONAL
-};
-
-// 光源结构体
-typedef struct {
-    enum light_type ltype;
-    float intensity;
-    vec3_t position;
-} light_t;
-
-
 // 场景参数
 #define VIEWPORT_SIZE 1.0f
 #define PROJECTION_PLANE_Z 1.0f
 #define BACKGROUND_COLOR 0x00000000
 #define NUM_SPHERES 4
 #define NUM_LIGHTS 3
+#define RAYTRACER_TILE_SIZE 32
+
+// 运行时大小可变的球体集合（定义见sphere_bvh.h）
+typedef struct sphere_set sphere_set_t;
 
-// 全局变量声明
+// 全局变量声明（渲染一帧期间只读，多个线程会同时访问）
+// spheres为默认场景数据，init_scene将其载入scene_spheres，光线追踪只访问scene_spheres
 extern sphere_t spheres[NUM_SPHERES];
+extern sphere_set_t scene_spheres;
 extern light_t lights[NUM_LIGHTS];
+// 默认场景的光源，init_scene将其复制到lights，光栅化场景也使用这组光源
+extern const light_t default_lights[NUM_LIGHTS];
 extern vec3_t camera_position;
-extern matrix_t camera_rotation;
+extern mat3_t camera_rotation;
 
 // 向量运算函数
 float dot_product(vec3_t v1, vec3_t v2);
@@ -62,10 +61,42 @@ vec3_t normalize(vec3_t v);
 vec3_t canvas_to_viewport(int x, int y);
 
 // 光线追踪函数
-intersection_result_t intersect_ray_sphere(vec3_t origin, vec3_t direction, sphere_t sphere);
-uint32_t trace_ray(vec3_t origin, vec3_t direction, float min_t, float max_t, int depth);
+intersection_result_t intersect_ray_sphere(vec3_t origin, vec3_t direction, const sphere_t* sphere);
+// 返回未截断的线性颜色，沿反射路径迭代计算（最多depth次反射）
+color_t trace_ray(vec3_t origin, vec3_t direction, float min_t, float max_t, int depth);
+
+// 将画面划分为RAYTRACER_TILE_SIZE大小的图块，交给线程池并行追踪
+// 结果先写入浮点HDR缓冲区，再逐行色调映射并打包写入color_buffer
+// pool为NULL时在调用线程串行执行，两种方式输出完全一致
+void raytracer_render_frame(thread_pool_t* pool);
+
+// 自上次重置以来追踪的光线数（主光线、反射光线和阴影光线）
+uint64_t raytracer_ray_count(void);
+void raytracer_reset_stats(void);
+
+// 最近一次raytracer_render_frame的HDR结果（window_width x window_height），尚未渲染时为NULL
+const color_t* raytracer_hdr_buffer(void);
+
+// 渐进式预览：第一遍以1/16分辨率追踪整个画面，之后在budget_ms内按颜色方差优先细化图块
+// 相机和场景不变时复用累积结果，每次调用继续细化并把当前结果写入color_buffer
+// 返回true表示已收敛到全分辨率（与raytracer_render_frame的结果一致）
+bool raytracer_render_progressive(thread_pool_t* pool, double budget_ms);
+
+// 直接修改灯光、球体材质等场景数据后调用，使渐进式预览重新开始
+// raytracer_add_model/raytracer_clear_models/init_scene/raytracer_update_scene已自动处理
+void raytracer_mark_scene_dirty(void);
+
+// 向光线追踪场景添加三角形网格（顶点为世界坐标），构建BVH并返回网格编号，失败返回-1
+// 模型数据在移除前须保持有效，三角形颜色取自triangle_t.color
+int raytracer_add_model(const model_t* model, float specular, float reflective);
+// 移除所有三角形网格
+void raytracer_clear_models(void);
 
 // 场景初始化函数
 void init_scene(void);
 
+// 修改scene_spheres中球体的位置或半径后调用，重拟合BVH
+// 增删球体后应调用sphere_set_build重建
+void raytracer_update_scene(void);
+
 #endif // RAYTRACER_H 
\ No newline at end of file
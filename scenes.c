@@ -0,0 +1,357 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "scenes.h"
+#include "display.h"
+#include "raster.h"
+#include "raytracer.h"
+#include "sphere_bvh.h"
+
+// 释放模型的顶点、三角形和顶点属性数组
+static void free_model_arrays(model_t* model) {
+    free(model->vertexes);
+    free(model->triangles);
+    free(model->normals);
+    free(model->uvs);
+    free(model->colors);
+}
+
+// 经纬度细分的球面，三角形数为2 * segments * segments，顶点、三角形和属性数组用malloc分配
+// 顶点带法向量和纹理坐标（u沿经度，v沿纬度），极点处的退化三角形保留，以便三角形数固定
+static bool make_sphere_mesh(vec3_t center, float radius, int segments, model_t* model) {
+    int rings = segments;
+    int vertex_count = (rings + 1) * (segments + 1);
+    int triangle_count = 2 * rings * segments;
+    vec3_t* vertexes = malloc(sizeof(vec3_t) * vertex_count);
+    triangle_t* triangles = malloc(sizeof(triangle_t) * triangle_count);
+    vec3_t* normals = malloc(sizeof(vec3_t) * vertex_count);
+    vec2_t* uvs = malloc(sizeof(vec2_t) * vertex_count);
+    if (!vertexes || !triangles || !normals || !uvs) {
+        free(vertexes);
+        free(triangles);
+        free(normals);
+        free(uvs);
+        return false;
+    }
+
+    for (int r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float phi = 2.0f * 3.14159265f * s / segments;
+            vec3_t n = {sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)};
+            int i = r * (segments + 1) + s;
+            vertexes[i] = (vec3_t){
+                center.x + radius * sinf(theta) * cosf(phi),
+                center.y + radius * cosf(theta),
+                center.z + radius * sinf(theta) * sinf(phi)
+            };
+            normals[i] = n;
+            uvs[i] = (vec2_t){(float)s / segments, (float)r / rings};
+        }
+    }
+    int t = 0;
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            int a = r * (segments + 1) + s;
+            int b = a + segments + 1;
+            uint32_t color = ((r + s) & 1) ? COLOR_CYAN : COLOR_PURPLE;
+            // 从外侧看为正面，与法向量方向一致
+            triangles[t++] = (triangle_t){a, a + 1, b, color};
+            triangles[t++] = (triangle_t){a + 1, b + 1, b, color};
+        }
+    }
+    *model = model_make(vertexes, vertex_count, triangles, triangle_count);
+    model->normals = normals;
+    model->uvs = uvs;
+    return true;
+}
+
+#pragma region 光栅化场景
+
+// 载入模型的镜面指数
+#define MODEL_FILE_SPECULAR 50.0f
+
+static vec3_t cube_vertexes[] = {
+    {  1,  1,  1 },
+    { -1,  1,  1 },
+    { -1, -1,  1 },
+    {  1, -1,  1 },
+    {  1,  1, -1 },
+    { -1,  1, -1 },
+    { -1, -1, -1 },
+    {  1, -1, -1 }
+};
+
+static triangle_t cube_triangles[] = {
+    {0, 1, 2, COLOR_RED},
+    {0, 2, 3, COLOR_RED},
+    {4, 0, 3, COLOR_GREEN},
+    {4, 3, 7, COLOR_GREEN},
+    {5, 4, 7, COLOR_BLUE},
+    {5, 7, 6, COLOR_BLUE},
+    {1, 5, 6, COLOR_YELLOW},
+    {1, 6, 2, COLOR_YELLOW},
+    {4, 5, 1, COLOR_PURPLE},
+    {4, 1, 0, COLOR_PURPLE},
+    {2, 6, 7, COLOR_CYAN},
+    {2, 7, 3, COLOR_CYAN}
+};
+
+static model_t make_cube_model(void) {
+    return model_make(cube_vertexes, 8, cube_triangles, 12);
+}
+
+static void init_clipping_planes(raster_scene_t* scene) {
+    float s2 = 0.70710678f; // sqrt(2)/2
+    scene->clipping_planes[0] = (plane_t){ { 0, 0, 1 }, -1 };     // Near
+    scene->clipping_planes[1] = (plane_t){ { s2, 0, s2 }, 0 };    // Left
+    scene->clipping_planes[2] = (plane_t){ { -s2, 0, s2 }, 0 };   // Right
+    scene->clipping_planes[3] = (plane_t){ { 0, -s2, s2 }, 0 };   // Top
+    scene->clipping_planes[4] = (plane_t){ { 0, s2, s2 }, 0 };    // Bottom
+    scene->camera.clipping_planes = scene->clipping_planes;
+    scene->camera.clipping_plane_count = 5;
+}
+
+// 场景只有一个模型，失败时不释放model的数组
+static bool alloc_raster_scene(raster_scene_t* scene, model_t model, int instance_count) {
+    scene->models = malloc(sizeof(model_t));
+    scene->instances = malloc(sizeof(instance_t) * instance_count);
+    if (!scene->models || !scene->instances || !model_build_soa(&model)) {
+        free(scene->models);
+        free(scene->instances);
+        return false;
+    }
+    scene->models[0] = model;
+    scene->model_count = 1;
+    scene->instance_count = instance_count;
+    return true;
+}
+
+bool raster_scene_cubes(raster_scene_t* scene) {
+    if (!alloc_raster_scene(scene, make_cube_model(), 2)) return false;
+    scene->instances[0] = (instance_t){
+        .model = &scene->models[0],
+        .position = { -1.5f, 0.0f, 7.0f },
+        .orientation = mat4_identity(),
+        .scale = 0.75
+    };
+    scene->instances[1] = (instance_t){
+        .model = &scene->models[0],
+        .position = {  1.25f, 2.5f, 7.5f },
+        .orientation = mat4_make_oy_rotation(195),
+        .scale = 1
+    };
+    scene->camera.position = (vec3_t){ -3.0f, 1.0f, 2.0f };
+    scene->camera.orientation = mat4_make_oy_rotation(-30);
+    init_clipping_planes(scene);
+    return true;
+}
+
+bool raster_scene_cube_grid(raster_scene_t* scene, int side) {
+    if (side < 1 || !alloc_raster_scene(scene, make_cube_model(), side * side)) return false;
+    // 视野半宽约为0.5 * z，网格放在能完整看到的距离上
+    float spacing = 2.5f;
+    float z = side * spacing + 3.0f;
+    for (int j = 0; j < side; j++) {
+        for (int i = 0; i < side; i++) {
+            scene->instances[j * side + i] = (instance_t){
+                .model = &scene->models[0],
+                .position = {
+                    (i - (side - 1) * 0.5f) * spacing,
+                    (j - (side - 1) * 0.5f) * spacing,
+                    z + ((i + j) % 3) * 0.5f
+                },
+                .orientation = mat4_make_oy_rotation((float)((i * 37 + j * 53) % 360)),
+                .scale = 1
+            };
+        }
+    }
+    scene->camera.position = (vec3_t){ 0.0f, 0.0f, 0.0f };
+    scene->camera.orientation = mat4_identity();
+    init_clipping_planes(scene);
+    return true;
+}
+
+bool raster_scene_cube_layers(raster_scene_t* scene, int side, int layers) {
+    if (side < 1 || layers < 1 || !alloc_raster_scene(scene, make_cube_model(), side * side * layers)) return false;
+    // 每层的立方体互相挨着，整层覆盖视野中央；按从近到远的顺序提交
+    float spacing = 1.2f;
+    float z = side * spacing * 0.5f + 6.0f;
+    for (int l = 0; l < layers; l++) {
+        for (int j = 0; j < side; j++) {
+            for (int i = 0; i < side; i++) {
+                scene->instances[(l * side + j) * side + i] = (instance_t){
+                    .model = &scene->models[0],
+                    .position = {
+                        (i - (side - 1) * 0.5f) * spacing,
+                        (j - (side - 1) * 0.5f) * spacing,
+                        z + l * 1.5f
+                    },
+                    .orientation = mat4_make_oy_rotation((float)((i * 37 + j * 53 + l * 71) % 360)),
+                    .scale = 1
+                };
+            }
+        }
+    }
+    scene->camera.position = (vec3_t){ 0.0f, 0.0f, 0.0f };
+    scene->camera.orientation = mat4_identity();
+    init_clipping_planes(scene);
+    return true;
+}
+
+bool raster_scene_mesh(raster_scene_t* scene, int segments) {
+    if (segments < 3) return false;
+    model_t mesh;
+    if (!make_sphere_mesh((vec3_t){0, 0, 0}, 1.0f, segments, &mesh)) return false;
+    if (!alloc_raster_scene(scene, mesh, 1)) {
+        free_model_arrays(&mesh);
+        return false;
+    }
+    scene->instances[0] = (instance_t){
+        .model = &scene->models[0],
+        .position = { 0.0f, 0.0f, 4.0f },
+        .orientation = mat4_make_oy_rotation(20),
+        .scale = 1.5f
+    };
+    scene->camera.position = (vec3_t){ 0.0f, 0.0f, 0.0f };
+    scene->camera.orientation = mat4_identity();
+    init_clipping_planes(scene);
+    return true;
+}
+
+bool raster_scene_model_file(raster_scene_t* scene, const char* obj_path) {
+    size_t length = strlen(obj_path);
+    char* cache_path = malloc(length + sizeof(".cache"));
+    scene->file = malloc(sizeof(model_file_t));
+    scene->instances = malloc(sizeof(instance_t));
+    bool ok = cache_path && scene->file && scene->instances;
+    if (ok) {
+        memcpy(cache_path, obj_path, length);
+        memcpy(cache_path + length, ".cache", sizeof(".cache"));
+        ok = model_load(obj_path, cache_path, scene->file);
+    }
+    free(cache_path);
+    if (!ok) {
+        free(scene->file);
+        free(scene->instances);
+        scene->file = NULL;
+        scene->instances = NULL;
+        return false;
+    }
+    model_t* model = &scene->file->model;
+    scene->models = model;
+    scene->model_count = 1;
+    scene->instance_count = 1;
+    // 包围球缩放到半径1.5，中心放在(0, 0, 4)
+    float scale = model->bounds_radius > 0.0f ? 1.5f / model->bounds_radius : 1.0f;
+    scene->instances[0] = (instance_t){
+        .model = model,
+        .position = vec3_sub((vec3_t){ 0.0f, 0.0f, 4.0f }, vec3_scale(model->bounds_center, scale)),
+        .orientation = mat4_identity(),
+        .scale = scale
+    };
+    scene->camera.position = (vec3_t){ 0.0f, 0.0f, 0.0f };
+    scene->camera.orientation = mat4_identity();
+    init_clipping_planes(scene);
+    return true;
+}
+
+void raster_scene_render(const raster_scene_t* scene) {
+    // 载入的模型是白色的，用光照区分各个面；三角形多时不画轮廓
+    set_triangle_outline_enabled(!scene->file);
+    if (scene->file) set_raster_lighting(RASTER_LIGHTING_VERTEX, default_lights, NUM_LIGHTS, MODEL_FILE_SPECULAR);
+    render_scene(scene->camera, scene->instances, scene->instance_count);
+}
+
+void raster_scene_free(raster_scene_t* scene) {
+    if (scene->file) {
+        // models指向file中的模型
+        model_file_free(scene->file);
+        free(scene->file);
+        scene->file = NULL;
+        scene->models = NULL;
+        scene->model_count = 0;
+    }
+    for (int i = 0; i < scene->model_count; i++) {
+        model_free_soa(&scene->models[i]);
+        // 立方体模型使用静态数组，其余模型的数组由场景分配
+        if (scene->models[i].vertexes != cube_vertexes) free_model_arrays(&scene->models[i]);
+    }
+    free(scene->instances);
+    free(scene->models);
+    scene->instances = NULL;
+    scene->models = NULL;
+    scene->instance_count = 0;
+    scene->model_count = 0;
+}
+
+#pragma endregion
+
+#pragma region 光线追踪场景
+
+// 光线追踪网格的数据，需在网格从场景移除前保持有效
+static model_t mesh_model;
+
+void raytrace_scene_free(void) {
+    raytracer_clear_models();
+    free_model_arrays(&mesh_model);
+    mesh_model = (model_t){0};
+}
+
+void raytrace_scene_spheres(void) {
+    raytrace_scene_free();
+    init_scene();
+}
+
+// 简单的线性同余随机数，保证各平台生成相同场景
+static float random_float(unsigned int* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (*state >> 8) * (1.0f / 16777216.0f);
+}
+
+bool raytrace_scene_random_spheres(int count, unsigned int seed) {
+    raytrace_scene_spheres();
+    sphere_set_clear(&scene_spheres);
+    if (sphere_set_add(&scene_spheres, spheres[3]) < 0) return false;  // 地面
+
+    // 球体分布在相机前方的立方体区域内，数量越多半径越小，保持总体积大致不变
+    vec3_t center = {-2.0f, 1.0f, 6.0f};
+    float extent = 2.0f;
+    float radius = 0.4f / cbrtf((float)count / 16.0f);
+    unsigned int state = seed;
+    for (int i = 0; i < count; i++) {
+        sphere_t s;
+        s.center.x = center.x + (random_float(&state) * 2 - 1) * extent;
+        s.center.y = center.y + (random_float(&state) * 2 - 1) * extent * 0.5f;
+        s.center.z = center.z + (random_float(&state) * 2 - 1) * extent;
+        s.radius = radius * (0.5f + random_float(&state));
+        s.color = 0xFF000000 |
+                  ((uint32_t)(random_float(&state) * 255) << 16) |
+                  ((uint32_t)(random_float(&state) * 255) << 8) |
+                  (uint32_t)(random_float(&state) * 255);
+        s.specular = random_float(&state) < 0.5f ? -1 : 100;
+        s.reflective = random_float(&state) * 0.5f;
+        if (sphere_set_add(&scene_spheres, s) < 0) return false;
+    }
+    if (!sphere_set_build(&scene_spheres)) return false;
+    raytracer_mark_scene_dirty();
+    return true;
+}
+
+bool raytrace_scene_mesh(int segments) {
+    raytrace_scene_spheres();
+    if (segments < 3) return false;
+
+    if (!make_sphere_mesh((vec3_t){-0.5f, 0.6f, 5.5f}, 1.2f, segments, &mesh_model)) {
+        raytrace_scene_free();
+        return false;
+    }
+
+    if (raytracer_add_model(&mesh_model, 50, 0.2f) < 0) {
+        raytrace_scene_free();
+        return false;
+    }
+    return true;
+}
+
+#pragma endregion
@@ -0,0 +1,44 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <stdbool.h>
+#include "geometry.h"
+#include "model_io.h"
+
+// 可复用的测试场景，供交互程序和基准测试共用
+
+// 光栅化场景：实例、相机和裁剪平面，模型数据由场景持有
+typedef struct {
+    model_t* models;
+    int model_count;
+    instance_t* instances;
+    int instance_count;
+    plane_t clipping_planes[5];
+    camera_t camera;
+    model_file_t* file;     // 从文件载入的模型（models指向其中的model），NULL表示模型由场景生成
+} raster_scene_t;
+
+// 两个立方体的裁剪测试场景（原clipping_test）
+bool raster_scene_cubes(raster_scene_t* scene);
+// side x side个立方体组成的网格，用于测试三角形数量增加时的性能
+bool raster_scene_cube_grid(raster_scene_t* scene, int side);
+// layers层前后重叠的side x side立方体，用于测试高重绘（overdraw）场景
+bool raster_scene_cube_layers(raster_scene_t* scene, int side, int layers);
+// 一个经纬度细分的球面网格，三角形数为2 * segments * segments，用于测试大网格的顶点处理
+bool raster_scene_mesh(raster_scene_t* scene, int segments);
+// 从OBJ文件载入的模型（缓存为obj_path加".cache"），缩放到半径1.5放在相机前方，使用默认光源的顶点光照
+bool raster_scene_model_file(raster_scene_t* scene, const char* obj_path);
+void raster_scene_render(const raster_scene_t* scene);
+void raster_scene_free(raster_scene_t* scene);
+
+// 光线追踪场景：直接替换raytracer的全局场景
+// init_scene中的四个球体
+void raytrace_scene_spheres(void);
+// 地面加count个随机球体，seed相同时场景相同
+bool raytrace_scene_random_spheres(int count, unsigned int seed);
+// 四个球体加一个细分球面网格，三角形数为2 * segments * segments
+bool raytrace_scene_mesh(int segments);
+// 释放光线追踪场景生成的网格
+void raytrace_scene_free(void);
+
+#endif // SCENES_H
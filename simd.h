@@ -0,0 +1,111 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// 按编译目标选择SIMD宽度的浮点向量封装：
+// AVX-512 16路，AVX2 8路，SSE2 4路，其余平台用4路标量回退
+// 所有运算逐通道进行，与对应的标量代码逐位一致（不使用FMA）
+
+#include <stdint.h>
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define SIMD_WIDTH 16
+typedef __m512 simd_float;
+typedef __mmask16 simd_mask;
+static inline simd_float simd_set1(float v) { return _mm512_set1_ps(v); }
+static inline simd_float simd_load(const float* p) { return _mm512_load_ps(p); }
+static inline simd_float simd_loadu(const float* p) { return _mm512_loadu_ps(p); }
+static inline void simd_store(float* p, simd_float a) { _mm512_store_ps(p, a); }
+static inline simd_float simd_add(simd_float a, simd_float b) { return _mm512_add_ps(a, b); }
+static inline simd_float simd_sub(simd_float a, simd_float b) { return _mm512_sub_ps(a, b); }
+static inline simd_float simd_mul(simd_float a, simd_float b) { return _mm512_mul_ps(a, b); }
+static inline simd_float simd_div(simd_float a, simd_float b) { return _mm512_div_ps(a, b); }
+static inline simd_float simd_min(simd_float a, simd_float b) { return _mm512_min_ps(a, b); }
+static inline simd_float simd_max(simd_float a, simd_float b) { return _mm512_max_ps(a, b); }
+static inline simd_float simd_sqrt(simd_float a) { return _mm512_sqrt_ps(a); }
+static inline simd_mask simd_cmplt(simd_float a, simd_float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+static inline simd_mask simd_cmple(simd_float a, simd_float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+static inline simd_mask simd_mask_and(simd_mask a, simd_mask b) { return a & b; }
+static inline simd_mask simd_mask_or(simd_mask a, simd_mask b) { return a | b; }
+static inline simd_float simd_select(simd_mask m, simd_float a, simd_float b) { return _mm512_mask_blend_ps(m, b, a); }
+static inline int simd_mask_bits(simd_mask m) { return (int)m; }
+
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+typedef __m256 simd_float;
+typedef __m256 simd_mask;
+static inline simd_float simd_set1(float v) { return _mm256_set1_ps(v); }
+static inline simd_float simd_load(const float* p) { return _mm256_load_ps(p); }
+static inline simd_float simd_loadu(const float* p) { return _mm256_loadu_ps(p); }
+static inline void simd_store(float* p, simd_float a) { _mm256_store_ps(p, a); }
+static inline simd_float simd_add(simd_float a, simd_float b) { return _mm256_add_ps(a, b); }
+static inline simd_float simd_sub(simd_float a, simd_float b) { return _mm256_sub_ps(a, b); }
+static inline simd_float simd_mul(simd_float a, simd_float b) { return _mm256_mul_ps(a, b); }
+static inline simd_float simd_div(simd_float a, simd_float b) { return _mm256_div_ps(a, b); }
+static inline simd_float simd_min(simd_float a, simd_float b) { return _mm256_min_ps(a, b); }
+static inline simd_float simd_max(simd_float a, simd_float b) { return _mm256_max_ps(a, b); }
+static inline simd_float simd_sqrt(simd_float a) { return _mm256_sqrt_ps(a); }
+static inline simd_mask simd_cmplt(simd_float a, simd_float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline simd_mask simd_cmple(simd_float a, simd_float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline simd_mask simd_mask_and(simd_mask a, simd_mask b) { return _mm256_and_ps(a, b); }
+static inline simd_mask simd_mask_or(simd_mask a, simd_mask b) { return _mm256_or_ps(a, b); }
+static inline simd_float simd_select(simd_mask m, simd_float a, simd_float b) { return _mm256_blendv_ps(b, a, m); }
+static inline int simd_mask_bits(simd_mask m) { return _mm256_movemask_ps(m); }
+
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+typedef __m128 simd_float;
+typedef __m128 simd_mask;
+static inline simd_float simd_set1(float v) { return _mm_set1_ps(v); }
+static inline simd_float simd_load(const float* p) { return _mm_load_ps(p); }
+static inline simd_float simd_loadu(const float* p) { return _mm_loadu_ps(p); }
+static inline void simd_store(float* p, simd_float a) { _mm_store_ps(p, a); }
+static inline simd_float simd_add(simd_float a, simd_float b) { return _mm_add_ps(a, b); }
+static inline simd_float simd_sub(simd_float a, simd_float b) { return _mm_sub_ps(a, b); }
+static inline simd_float simd_mul(simd_float a, simd_float b) { return _mm_mul_ps(a, b); }
+static inline simd_float simd_div(simd_float a, simd_float b) { return _mm_div_ps(a, b); }
+static inline simd_float simd_min(simd_float a, simd_float b) { return _mm_min_ps(a, b); }
+static inline simd_float simd_max(simd_float a, simd_float b) { return _mm_max_ps(a, b); }
+static inline simd_float simd_sqrt(simd_float a) { return _mm_sqrt_ps(a); }
+static inline simd_mask simd_cmplt(simd_float a, simd_float b) { return _mm_cmplt_ps(a, b); }
+static inline simd_mask simd_cmple(simd_float a, simd_float b) { return _mm_cmple_ps(a, b); }
+static inline simd_mask simd_mask_and(simd_mask a, simd_mask b) { return _mm_and_ps(a, b); }
+static inline simd_mask simd_mask_or(simd_mask a, simd_mask b) { return _mm_or_ps(a, b); }
+static inline simd_float simd_select(simd_mask m, simd_float a, simd_float b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+static inline int simd_mask_bits(simd_mask m) { return _mm_movemask_ps(m); }
+
+#else
+#include <math.h>
+#define SIMD_WIDTH 4
+#define SIMD_SCALAR 1
+typedef struct { float v[SIMD_WIDTH]; } simd_float;
+typedef struct { int v[SIMD_WIDTH]; } simd_mask;
+#define SIMD_LANES(expr) for (int i_ = 0; i_ < SIMD_WIDTH; i_++) { expr; }
+static inline simd_float simd_set1(float v) { simd_float r; SIMD_LANES(r.v[i_] = v) return r; }
+static inline simd_float simd_load(const float* p) { simd_float r; SIMD_LANES(r.v[i_] = p[i_]) return r; }
+static inline simd_float simd_loadu(const float* p) { return simd_load(p); }
+static inline void simd_store(float* p, simd_float a) { SIMD_LANES(p[i_] = a.v[i_]) }
+static inline simd_float simd_add(simd_float a, simd_float b) { simd_float r; SIMD_LANES(r.v[i_] = a.v[i_] + b.v[i_]) return r; }
+static inline simd_float simd_sub(simd_float a, simd_float b) { simd_float r; SIMD_LANES(r.v[i_] = a.v[i_] - b.v[i_]) return r; }
+static inline simd_float simd_mul(simd_float a, simd_float b) { simd_float r; SIMD_LANES(r.v[i_] = a.v[i_] * b.v[i_]) return r; }
+static inline simd_float simd_div(simd_float a, simd_float b) { simd_float r; SIMD_LANES(r.v[i_] = a.v[i_] / b.v[i_]) return r; }
+static inline simd_float simd_min(simd_float a, simd_float b) { simd_float r; SIMD_LANES(r.v[i_] = a.v[i_] < b.v[i_] ? a.v[i_] : b.v[i_]) return r; }
+static inline simd_float simd_max(simd_float a, simd_float b) { simd_float r; SIMD_LANES(r.v[i_] = a.v[i_] > b.v[i_] ? a.v[i_] : b.v[i_]) return r; }
+static inline simd_float simd_sqrt(simd_float a) { simd_float r; SIMD_LANES(r.v[i_] = sqrtf(a.v[i_])) return r; }
+static inline simd_mask simd_cmplt(simd_float a, simd_float b) { simd_mask r; SIMD_LANES(r.v[i_] = a.v[i_] < b.v[i_]) return r; }
+static inline simd_mask simd_cmple(simd_float a, simd_float b) { simd_mask r; SIMD_LANES(r.v[i_] = a.v[i_] <= b.v[i_]) return r; }
+static inline simd_mask simd_mask_and(simd_mask a, simd_mask b) { simd_mask r; SIMD_LANES(r.v[i_] = a.v[i_] && b.v[i_]) return r; }
+static inline simd_mask simd_mask_or(simd_mask a, simd_mask b) { simd_mask r; SIMD_LANES(r.v[i_] = a.v[i_] || b.v[i_]) return r; }
+static inline simd_float simd_select(simd_mask m, simd_float a, simd_float b) { simd_float r; SIMD_LANES(r.v[i_] = m.v[i_] ? a.v[i_] : b.v[i_]) return r; }
+static inline int simd_mask_bits(simd_mask m) { int bits = 0; SIMD_LANES(bits |= (m.v[i_] ? 1 : 0) << i_) return bits; }
+#undef SIMD_LANES
+#endif
+
+// 按SIMD宽度对齐的字节数
+#define SIMD_ALIGN (SIMD_WIDTH * 4)
+
+#endif // SIMD_H
@@ -0,0 +1,383 @@
+#include "sphere_bvh.h"
+#include "aabb.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define SAH_BIN_COUNT 16
+#define BVH_STACK_SIZE 64
+// 超过该深度后改用对半划分，保证遍历栈不会溢出
+#define BVH_MAX_SAH_DEPTH 40
+
+static void grow_by_sphere(aabb_t* box, const sphere_t* s) {
+    vec3_t r = {s->radius, s->radius, s->radius};
+    aabb_grow(box, vec3_sub(s->center, r), vec3_add(s->center, r));
+}
+
+// 叶子的求交代价按SIMD批次计算
+static int simd_batches(int n) {
+    return (n + SIMD_WIDTH - 1) / SIMD_WIDTH;
+}
+
+typedef struct {
+    sphere_set_t* set;
+    int* refs;          // 球体下标，构建过程中按划分结果重排
+    int leaf_count;
+} build_context_t;
+
+static int centroid_bin(vec3_t c, int axis, float lo, float scale) {
+    int b = (int)((vec3_axis(c, axis) - lo) * scale);
+    if (b < 0) b = 0;
+    if (b >= SAH_BIN_COUNT) b = SAH_BIN_COUNT - 1;
+    return b;
+}
+
+// 叶子节点暂存first=refs起始位置、count=球体数，构建完成后再换成SoA槽位
+static void build_node(build_context_t* ctx, int node_index, int begin, int end, int depth) {
+    sphere_set_t* set = ctx->set;
+    const sphere_t* spheres = set->spheres;
+    aabb_t bounds = aabb_empty();
+    aabb_t centroid_bounds = aabb_empty();
+    for (int i = begin; i < end; i++) {
+        const sphere_t* s = &spheres[ctx->refs[i]];
+        grow_by_sphere(&bounds, s);
+        aabb_grow(&centroid_bounds, s->center, s->center);
+    }
+    set->nodes[node_index].min = bounds.min;
+    set->nodes[node_index].max = bounds.max;
+
+    int n = end - begin;
+    if (n <= SIMD_WIDTH) {
+        set->nodes[node_index].first = begin;
+        set->nodes[node_index].count = n;
+        ctx->leaf_count++;
+        return;
+    }
+
+    // 在三个轴上分箱，选SAH代价最小的划分
+    int best_axis = -1, best_split = 0;
+    float best_cost = INFINITY;
+    if (depth < BVH_MAX_SAH_DEPTH) {
+        for (int axis = 0; axis < 3; axis++) {
+            float lo = vec3_axis(centroid_bounds.min, axis);
+            float hi = vec3_axis(centroid_bounds.max, axis);
+            if (hi <= lo) continue;
+            float scale = SAH_BIN_COUNT / (hi - lo);
+
+            aabb_t bin_bounds[SAH_BIN_COUNT];
+            int bin_count[SAH_BIN_COUNT] = {0};
+            for (int b = 0; b < SAH_BIN_COUNT; b++) bin_bounds[b] = aabb_empty();
+            for (int i = begin; i < end; i++) {
+                const sphere_t* s = &spheres[ctx->refs[i]];
+                int b = centroid_bin(s->center, axis, lo, scale);
+                grow_by_sphere(&bin_bounds[b], s);
+                bin_count[b]++;
+            }
+
+            // 从右向左累积右侧面积，再从左向右扫描
+            float right_area[SAH_BIN_COUNT];
+            int right_count[SAH_BIN_COUNT];
+            aabb_t acc = aabb_empty();
+            int cnt = 0;
+            for (int b = SAH_BIN_COUNT - 1; b > 0; b--) {
+                aabb_grow(&acc, bin_bounds[b].min, bin_bounds[b].max);
+                cnt += bin_count[b];
+                right_area[b] = aabb_area(acc);
+                right_count[b] = cnt;
+            }
+            acc = aabb_empty();
+            cnt = 0;
+            for (int b = 1; b < SAH_BIN_COUNT; b++) {
+                aabb_grow(&acc, bin_bounds[b - 1].min, bin_bounds[b - 1].max);
+                cnt += bin_count[b - 1];
+                if (cnt == 0 || right_count[b] == 0) continue;
+                float cost = aabb_area(acc) * simd_batches(cnt) + right_area[b] * simd_batches(right_count[b]);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b;
+                }
+            }
+        }
+    }
+
+    int mid = begin + n / 2;
+    int axis = 0;
+    if (best_axis >= 0) {
+        axis = best_axis;
+        float lo = vec3_axis(centroid_bounds.min, axis);
+        float scale = SAH_BIN_COUNT / (vec3_axis(centroid_bounds.max, axis) - lo);
+        int i = begin, j = end - 1;
+        while (i <= j) {
+            if (centroid_bin(spheres[ctx->refs[i]].center, axis, lo, scale) < best_split) {
+                i++;
+            } else {
+                int tmp = ctx->refs[i];
+                ctx->refs[i] = ctx->refs[j];
+                ctx->refs[j--] = tmp;
+            }
+        }
+        if (i > begin && i < end) mid = i;
+    }
+
+    int left = set->node_count;
+    set->node_count += 2;
+    set->nodes[node_index].first = left;
+    set->nodes[node_index].count = -1 - axis;
+    build_node(ctx, left, begin, mid, depth + 1);
+    build_node(ctx, left + 1, mid, end, depth + 1);
+}
+
+// 树的SAH代价：内部节点面积之和相对根节点面积，与场景整体缩放无关
+static float tree_cost(const sphere_set_t* set) {
+    const sphere_bvh_node_t* root = &set->nodes[0];
+    float root_area = aabb_area((aabb_t){root->min, root->max});
+    if (root_area <= 0) return 0.0f;
+    float sum = 0.0f;
+    for (int i = 0; i < set->node_count; i++) {
+        const sphere_bvh_node_t* node = &set->nodes[i];
+        if (node->count < 0) sum += aabb_area((aabb_t){node->min, node->max});
+    }
+    return sum / root_area;
+}
+
+void sphere_set_init(sphere_set_t* set) {
+    *set = (sphere_set_t){0};
+}
+
+void sphere_set_free(sphere_set_t* set) {
+    free(set->spheres);
+    free(set->nodes);
+    free(set->slot_sphere);
+    sphere_soa_free(&set->soa);
+    sphere_set_init(set);
+}
+
+void sphere_set_clear(sphere_set_t* set) {
+    set->count = 0;
+    set->node_count = 0;
+    sphere_soa_resize(&set->soa, 0);
+}
+
+int sphere_set_add(sphere_set_t* set, sphere_t sphere) {
+    if (set->count == set->capacity) {
+        int capacity = set->capacity ? set->capacity * 2 : 16;
+        sphere_t* spheres = realloc(set->spheres, sizeof(sphere_t) * capacity);
+        if (!spheres) return -1;
+        set->spheres = spheres;
+        set->capacity = capacity;
+    }
+    set->spheres[set->count] = sphere;
+    return set->count++;
+}
+
+// 释放BVH和SoA数据，集合回到没有BVH的状态（球体数组保留）
+static void reset_bvh(sphere_set_t* set) {
+    free(set->nodes);
+    free(set->slot_sphere);
+    set->nodes = NULL;
+    set->slot_sphere = NULL;
+    set->node_count = 0;
+    set->build_cost = 0.0f;
+    sphere_soa_resize(&set->soa, 0);
+}
+
+bool sphere_set_build(sphere_set_t* set) {
+    reset_bvh(set);
+    if (set->count == 0) return true;
+
+    build_context_t ctx = {set, malloc(sizeof(int) * set->count), 0};
+    set->nodes = malloc(sizeof(sphere_bvh_node_t) * (2 * set->count - 1));
+    if (!ctx.refs || !set->nodes) {
+        free(ctx.refs);
+        reset_bvh(set);
+        return false;
+    }
+    for (int i = 0; i < set->count; i++) ctx.refs[i] = i;
+    set->node_count = 1;
+    build_node(&ctx, 0, 0, set->count, 0);
+
+    // 每个叶子占一组SIMD_WIDTH个槽位，按节点顺序分配
+    int slot_count = ctx.leaf_count * SIMD_WIDTH;
+    set->slot_sphere = malloc(sizeof(int) * slot_count);
+    if (!set->slot_sphere || !sphere_soa_resize(&set->soa, slot_count)) {
+        free(ctx.refs);
+        reset_bvh(set);
+        return false;
+    }
+    int slot = 0;
+    for (int i = 0; i < set->node_count; i++) {
+        sphere_bvh_node_t* node = &set->nodes[i];
+        if (node->count < 0) continue;
+        for (int k = 0; k < SIMD_WIDTH; k++) {
+            int index = k < node->count ? ctx.refs[node->first + k] : -1;
+            set->slot_sphere[slot + k] = index;
+            sphere_soa_set(&set->soa, slot + k, index >= 0 ? &set->spheres[index] : NULL);
+        }
+        node->first = slot;
+        node->count = SIMD_WIDTH;
+        slot += SIMD_WIDTH;
+    }
+    free(ctx.refs);
+    set->build_cost = tree_cost(set);
+    return true;
+}
+
+bool sphere_set_refit(sphere_set_t* set) {
+    if (set->node_count == 0) return true;
+    for (int slot = 0; slot < set->soa.count; slot++) {
+        int index = set->slot_sphere[slot];
+        sphere_soa_set(&set->soa, slot, index >= 0 ? &set->spheres[index] : NULL);
+    }
+    // 子节点下标总是大于父节点，逆序遍历即为自底向上
+    for (int i = set->node_count - 1; i >= 0; i--) {
+        sphere_bvh_node_t* node = &set->nodes[i];
+        aabb_t bounds = aabb_empty();
+        if (node->count > 0) {
+            for (int k = 0; k < node->count; k++) {
+                int index = set->slot_sphere[node->first + k];
+                if (index >= 0) grow_by_sphere(&bounds, &set->spheres[index]);
+            }
+        } else {
+            const sphere_bvh_node_t* l = &set->nodes[node->first];
+            const sphere_bvh_node_t* r = &set->nodes[node->first + 1];
+            aabb_grow(&bounds, l->min, l->max);
+            aabb_grow(&bounds, r->min, r->max);
+        }
+        node->min = bounds.min;
+        node->max = bounds.max;
+    }
+    // 构建代价为0（根节点面积为0，如所有球体重合）时无法比较，不重建
+    if (set->build_cost > 0.0f && tree_cost(set) > 2.0f * set->build_cost) {
+        return sphere_set_build(set);
+    }
+    return true;
+}
+
+static inline bool ray_hits_node(const sphere_bvh_node_t* node, vec3_t origin, vec3_t inv_dir,
+                                 float t_min, float t_max) {
+    return ray_hits_aabb(node->min, node->max, origin, inv_dir, t_min, t_max);
+}
+
+int sphere_set_closest(const sphere_set_t* set, vec3_t origin, vec3_t direction,
+                       float min_t, float max_t, float* out_t) {
+    *out_t = INFINITY;
+    if (set->node_count == 0) return -1;
+
+    vec3_t inv_dir = {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+    float best_t = max_t;
+    int best_slot = -1;
+    int stack[BVH_STACK_SIZE];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const sphere_bvh_node_t* node = &set->nodes[stack[--sp]];
+        if (!ray_hits_node(node, origin, inv_dir, min_t, best_t)) continue;
+        if (node->count > 0) {
+            int slot = sphere_soa_closest_range(&set->soa, node->first, node->first + node->count,
+                                                origin, direction, min_t, &best_t);
+            if (slot >= 0) best_slot = slot;
+        } else {
+            // 沿划分轴先访问近处的子节点
+            bool near_is_left = vec3_axis(direction, -1 - node->count) >= 0;
+            stack[sp++] = near_is_left ? node->first + 1 : node->first;
+            stack[sp++] = near_is_left ? node->first : node->first + 1;
+        }
+    }
+    if (best_slot < 0) return -1;
+    *out_t = best_t;
+    return set->slot_sphere[best_slot];
+}
+
+// 光线通过包围盒测试且叶子中有交点
+static bool leaf_occludes(const sphere_set_t* set, const sphere_bvh_node_t* node,
+                          vec3_t origin, vec3_t direction, vec3_t inv_dir, float min_t, float max_t) {
+    return ray_hits_node(node, origin, inv_dir, min_t, max_t) &&
+           sphere_soa_any_range(&set->soa, node->first, node->first + node->count,
+                                origin, direction, min_t, max_t);
+}
+
+bool sphere_set_occluded(const sphere_set_t* set, vec3_t origin, vec3_t direction,
+                         float min_t, float max_t, int* leaf_hint) {
+    if (set->node_count == 0) return false;
+    vec3_t inv_dir = {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+
+    // 相邻像素的阴影光线通常被同一物体遮挡，先测试上次的遮挡叶子
+    // 父节点包围盒包含子节点，叶子通过测试时其祖先必然通过，因此结果与完整遍历一致
+    int hint = *leaf_hint;
+    if (hint >= 0 && hint < set->node_count && set->nodes[hint].count > 0 &&
+        leaf_occludes(set, &set->nodes[hint], origin, direction, inv_dir, min_t, max_t)) {
+        return true;
+    }
+
+    int stack[BVH_STACK_SIZE];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        int index = stack[--sp];
+        const sphere_bvh_node_t* node = &set->nodes[index];
+        if (node->count > 0) {
+            if (index != hint && leaf_occludes(set, node, origin, direction, inv_dir, min_t, max_t)) {
+                *leaf_hint = index;
+                return true;
+            }
+        } else if (ray_hits_node(node, origin, inv_dir, min_t, max_t)) {
+            stack[sp++] = node->first + 1;
+            stack[sp++] = node->first;
+        }
+    }
+    return false;
+}
+
+void sphere_set_closest_packet(const sphere_set_t* set, const ray_packet_t* packet,
+                               float min_t, float max_t, ray_packet_hit_t* hit) {
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        hit->t[lane] = max_t;
+        hit->index[lane] = -1;
+    }
+    if (set->node_count > 0) {
+        simd_float ox = simd_load(packet->ox), oy = simd_load(packet->oy), oz = simd_load(packet->oz);
+        simd_float one = simd_set1(1.0f);
+        simd_float ix = simd_div(one, simd_load(packet->dx));
+        simd_float iy = simd_div(one, simd_load(packet->dy));
+        simd_float iz = simd_div(one, simd_load(packet->dz));
+        simd_float vmin = simd_set1(min_t);
+        simd_float best_t = simd_load(hit->t);
+        vec3_t lead = {packet->dx[0], packet->dy[0], packet->dz[0]};
+
+        int stack[BVH_STACK_SIZE];
+        int sp = 0;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            const sphere_bvh_node_t* node = &set->nodes[stack[--sp]];
+            simd_float tx0 = simd_mul(simd_sub(simd_set1(node->min.x), ox), ix);
+            simd_float tx1 = simd_mul(simd_sub(simd_set1(node->max.x), ox), ix);
+            simd_float ty0 = simd_mul(simd_sub(simd_set1(node->min.y), oy), iy);
+            simd_float ty1 = simd_mul(simd_sub(simd_set1(node->max.y), oy), iy);
+            simd_float tz0 = simd_mul(simd_sub(simd_set1(node->min.z), oz), iz);
+            simd_float tz1 = simd_mul(simd_sub(simd_set1(node->max.z), oz), iz);
+            simd_float t_enter = simd_max(simd_max(simd_min(tx0, tx1), simd_min(ty0, ty1)),
+                                          simd_max(simd_min(tz0, tz1), vmin));
+            simd_float t_exit = simd_min(simd_min(simd_max(tx0, tx1), simd_max(ty0, ty1)),
+                                         simd_min(simd_max(tz0, tz1), best_t));
+            // 只要包中有一条光线进入包围盒就继续向下遍历
+            if (simd_mask_bits(simd_cmple(t_enter, t_exit)) == 0) continue;
+            if (node->count > 0) {
+                ray_packet_closest_range(&set->soa, node->first, node->first + node->count,
+                                         packet, min_t, hit);
+                best_t = simd_load(hit->t);
+            } else {
+                // 以第一条光线的方向决定访问顺序
+                bool near_is_left = vec3_axis(lead, -1 - node->count) >= 0;
+                stack[sp++] = near_is_left ? node->first + 1 : node->first;
+                stack[sp++] = near_is_left ? node->first : node->first + 1;
+            }
+        }
+    }
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        if (hit->index[lane] >= 0) {
+            hit->index[lane] = set->slot_sphere[hit->index[lane]];
+        } else {
+            hit->t[lane] = INFINITY;
+        }
+    }
+}
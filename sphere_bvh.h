@@ -0,0 +1,58 @@
+#ifndef SPHERE_BVH_H
+#define SPHERE_BVH_H
+
+#include "raytracer.h"
+#include "ray_packet.h"
+
+// BVH节点，32字节，两个节点占一条缓存行
+// 叶子节点：first为第一个SoA槽位，count为槽位数（SIMD_WIDTH的整数倍）
+// 内部节点：first为左子节点下标（右子节点为first+1），count为-1-划分轴
+typedef struct {
+    vec3_t min;
+    int first;
+    vec3_t max;
+    int count;
+} sphere_bvh_node_t;
+
+// 运行时大小可变的球体集合，带SAH构建的BVH
+// 球体下标在两次sphere_set_build之间保持不变，叶子按SIMD_WIDTH个槽位存放SoA数据
+typedef struct sphere_set {
+    sphere_t* spheres;
+    int count;
+    int capacity;
+    sphere_bvh_node_t* nodes;
+    int node_count;
+    int* slot_sphere;       // SoA槽位对应的球体下标，空槽位为-1
+    sphere_soa_t soa;
+    float build_cost;       // 构建时的SAH代价，重拟合后代价过高则重建
+} sphere_set_t;
+
+void sphere_set_init(sphere_set_t* set);
+void sphere_set_free(sphere_set_t* set);
+void sphere_set_clear(sphere_set_t* set);
+
+// 添加球体并返回其下标，添加后需调用sphere_set_build
+int sphere_set_add(sphere_set_t* set, sphere_t sphere);
+
+// 用分箱SAH重新构建BVH，内存不足时集合没有BVH（查询都不命中）并返回false
+bool sphere_set_build(sphere_set_t* set);
+
+// 球体移动或半径改变后调用：自底向上更新包围盒，不改变树结构
+// 若树的质量明显退化（SAH代价翻倍）则自动重建，重建失败时返回false
+bool sphere_set_refit(sphere_set_t* set);
+
+// 返回(min_t, max_t)内最近球体的下标并写入out_t，无交点时返回-1
+int sphere_set_closest(const sphere_set_t* set, vec3_t origin, vec3_t direction,
+                       float min_t, float max_t, float* out_t);
+
+// 遮挡查询：(min_t, max_t)内有任意交点即返回true，找到第一个遮挡物就结束遍历
+// leaf_hint为上次遮挡物所在叶子节点（-1表示无），先测试该叶子，命中后更新为新的遮挡叶子
+// 结果与是否使用leaf_hint无关：只有光线能通过叶子包围盒测试时才接受该叶子中的交点
+bool sphere_set_occluded(const sphere_set_t* set, vec3_t origin, vec3_t direction,
+                         float min_t, float max_t, int* leaf_hint);
+
+// 光线包遍历BVH，hit->index为球体下标，未命中为-1
+void sphere_set_closest_packet(const sphere_set_t* set, const ray_packet_t* packet,
+                               float min_t, float max_t, ray_packet_hit_t* hit);
+
+#endif // SPHERE_BVH_H
@@ -0,0 +1,172 @@
+#include "texture.h"
+#include "raster.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// 纹理内存按缓存行对齐，每个图块正好占一条缓存行
+#define TEXTURE_ALIGNMENT 64
+
+static size_t level_texel_count(int width, int height) {
+    size_t tiles_x = (width + TEXTURE_TILE - 1) / TEXTURE_TILE;
+    size_t tiles_y = (height + TEXTURE_TILE - 1) / TEXTURE_TILE;
+    return tiles_x * tiles_y * TEXTURE_TILE * TEXTURE_TILE;
+}
+
+// 2x2纹素按通道求平均（四舍五入），奇数尺寸时边缘的纹素重复使用
+static void build_level(const texture_level_t* src, texture_level_t* dst) {
+    for (int y = 0; y < dst->height; y++) {
+        int y0 = 2 * y, y1 = 2 * y + 1 < src->height ? 2 * y + 1 : src->height - 1;
+        for (int x = 0; x < dst->width; x++) {
+            int x0 = 2 * x, x1 = 2 * x + 1 < src->width ? 2 * x + 1 : src->width - 1;
+            uint32_t c[4] = {
+                texture_texel(src, x0, y0), texture_texel(src, x1, y0),
+                texture_texel(src, x0, y1), texture_texel(src, x1, y1)
+            };
+            uint32_t out = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                uint32_t sum = 2;
+                for (int i = 0; i < 4; i++) sum += (c[i] >> shift) & 0xFF;
+                out |= (sum >> 2) << shift;
+            }
+            dst->texels[texture_texel_index(dst, x, y)] = out;
+        }
+    }
+}
+
+bool texture_create(texture_t* texture, const uint32_t* pixels, int width, int height) {
+    *texture = (texture_t){0};
+    if (width <= 0 || height <= 0) return false;
+
+    // 先确定各级尺寸，所有级别放在同一块内存中
+    int w = width, h = height, count = 0;
+    size_t total = 0;
+    for (;;) {
+        texture_level_t* level = &texture->levels[count++];
+        level->width = w;
+        level->height = h;
+        level->tiles_x = (w + TEXTURE_TILE - 1) / TEXTURE_TILE;
+        total += level_texel_count(w, h);
+        if ((w == 1 && h == 1) || count == TEXTURE_MAX_LEVELS) break;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    size_t bytes = (total * sizeof(uint32_t) + TEXTURE_ALIGNMENT - 1) & ~(size_t)(TEXTURE_ALIGNMENT - 1);
+    uint32_t* data = aligned_alloc(TEXTURE_ALIGNMENT, bytes);
+    if (!data) {
+        *texture = (texture_t){0};
+        return false;
+    }
+    // 补齐到图块的纹素不会被采样，清零只为内容确定
+    memset(data, 0, bytes);
+    texture->data = data;
+    texture->level_count = count;
+    size_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        texture_level_t* level = &texture->levels[i];
+        level->texels = data + offset;
+        offset += level_texel_count(level->width, level->height);
+    }
+
+    texture_level_t* base = &texture->levels[0];
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            base->texels[texture_texel_index(base, x, y)] = pixels[(size_t)width * y + x];
+        }
+    }
+    for (int i = 1; i < count; i++) build_level(&texture->levels[i - 1], &texture->levels[i]);
+    return true;
+}
+
+void texture_free(texture_t* texture) {
+    free(texture->data);
+    *texture = (texture_t){0};
+}
+
+// 两个ARGB颜色按8位权重w（0~256）逐通道插值，两个通道一组用32位整数同时计算
+static inline uint32_t lerp_argb(uint32_t a, uint32_t b, uint32_t w) {
+    uint32_t iw = 256 - w;
+    uint32_t rb = (((a & 0x00FF00FF) * iw + (b & 0x00FF00FF) * w) >> 8) & 0x00FF00FF;
+    uint32_t ag = (((a >> 8) & 0x00FF00FF) * iw + ((b >> 8) & 0x00FF00FF) * w) & 0xFF00FF00;
+    return rb | ag;
+}
+
+// 纹理坐标环绕到[0, 1)，无效值取0
+static inline float wrap_coordinate(float u) {
+    u -= floorf(u);
+    return u >= 0.0f && u < 1.0f ? u : 0.0f;
+}
+
+static uint32_t sample_nearest(const texture_level_t* level, float u, float v) {
+    int x = (int)(u * level->width), y = (int)(v * level->height);
+    if (x >= level->width) x = level->width - 1;
+    if (y >= level->height) y = level->height - 1;
+    return texture_texel(level, x, y);
+}
+
+// u, v已环绕到[0, 1)，相邻纹素最多越过边界一个，不需要取模
+static uint32_t sample_bilinear(const texture_level_t* level, float u, float v) {
+    float fx = u * level->width - 0.5f, fy = v * level->height - 0.5f;
+    float x0f = floorf(fx), y0f = floorf(fy);
+    uint32_t wx = (uint32_t)((fx - x0f) * 256.0f + 0.5f);
+    uint32_t wy = (uint32_t)((fy - y0f) * 256.0f + 0.5f);
+    int x0 = (int)x0f, y0 = (int)y0f;
+    int x1 = x0 + 1, y1 = y0 + 1;
+    if (x0 < 0) x0 = level->width - 1;
+    if (y0 < 0) y0 = level->height - 1;
+    if (x1 >= level->width) x1 = 0;
+    if (y1 >= level->height) y1 = 0;
+    uint32_t top = lerp_argb(texture_texel(level, x0, y0), texture_texel(level, x1, y0), wx);
+    uint32_t bottom = lerp_argb(texture_texel(level, x0, y1), texture_texel(level, x1, y1), wx);
+    return lerp_argb(top, bottom, wy);
+}
+
+uint32_t texture_sample(const texture_t* texture, float u, float v,
+                        float dudx, float dvdx, float dudy, float dvdy, texture_filter_t filter) {
+    u = wrap_coordinate(u);
+    v = wrap_coordinate(v);
+    // 屏幕上一个像素覆盖的第0级纹素数（取x、y两个方向中较大者）的log2即mip级别
+    const texture_level_t* base = &texture->levels[0];
+    float w = (float)base->width, h = (float)base->height;
+    float rx = dudx * dudx * w * w + dvdx * dvdx * h * h;
+    float ry = dudy * dudy * w * w + dvdy * dvdy * h * h;
+    float rho_sq = rx > ry ? rx : ry;
+    float lod = rho_sq > 1.0f ? 0.5f * log2f(rho_sq) : 0.0f;
+    float max_lod = (float)(texture->level_count - 1);
+    if (!(lod < max_lod)) lod = max_lod;
+
+    if (filter == TEXTURE_FILTER_TRILINEAR) {
+        int level = (int)lod;
+        uint32_t t = (uint32_t)((lod - level) * 256.0f + 0.5f);
+        uint32_t a = sample_bilinear(&texture->levels[level], u, v);
+        if (t == 0 || level + 1 >= texture->level_count) return a;
+        return lerp_argb(a, sample_bilinear(&texture->levels[level + 1], u, v), t);
+    }
+    const texture_level_t* level = &texture->levels[(int)(lod + 0.5f)];
+    return filter == TEXTURE_FILTER_NEAREST ? sample_nearest(level, u, v) : sample_bilinear(level, u, v);
+}
+
+// 纹素的r, g, b分别乘以rgb（截断到[0, 1]）
+static uint32_t modulate(uint32_t texel, const float* rgb) {
+    uint32_t out = texel & 0xFF000000;
+    for (int i = 0; i < 3; i++) {
+        float f = rgb[i] < 0.0f ? 0.0f : (rgb[i] > 1.0f ? 1.0f : rgb[i]);
+        int shift = 16 - 8 * i;
+        out |= (uint32_t)(((texel >> shift) & 0xFF) * f + 0.5f) << shift;
+    }
+    return out;
+}
+
+uint32_t texture_fragment_shader(const fragment_t* fragment, uint32_t color, const void* uniforms) {
+    (void)color;
+    const texture_shader_params_t* params = uniforms;
+    int k = fragment->varying_count - 2;
+    const float* uv = fragment->varyings + k;
+    uint32_t texel = !fragment->ddx
+        ? texture_sample(params->texture, uv[0], uv[1], 0, 0, 0, 0, params->filter)
+        : texture_sample(params->texture, uv[0], uv[1],
+                         fragment->ddx[k], fragment->ddx[k + 1],
+                         fragment->ddy[k], fragment->ddy[k + 1], params->filter);
+    // 带颜色属性时（如光照后的颜色）调制纹理颜色，颜色总在最前
+    return fragment->varying_flags & RASTER_VARYING_COLOR ? modulate(texel, fragment->varyings) : texel;
+}
@@ -0,0 +1,64 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ARGB8888纹理，带完整的mipmap链，纹理坐标按重复（repeat）方式环绕
+// 每一级按4x4纹素的图块存储：一个图块64字节，正好是一条缓存行，图块按行优先排列
+// 双线性采样的2x2纹素大多落在同一个图块内，沿任意方向移动时访问的缓存行数相近
+// 缩小时按屏幕导数选择mip级别，每个像素访问的纹素数和缓存行数不随纹理大小增长
+
+#define TEXTURE_TILE 4
+#define TEXTURE_MAX_LEVELS 16
+
+typedef enum {
+    TEXTURE_FILTER_NEAREST,     // 最近的mip级别上取最近的纹素
+    TEXTURE_FILTER_BILINEAR,    // 最近的mip级别上双线性插值
+    TEXTURE_FILTER_TRILINEAR    // 相邻两个mip级别上各做双线性插值，再按级别的小数部分混合
+} texture_filter_t;
+
+typedef struct {
+    int width, height;
+    int tiles_x;                // 每行的图块数
+    uint32_t* texels;           // 按图块存储，长度为tiles_x * tiles_y * 16
+} texture_level_t;
+
+typedef struct {
+    texture_level_t levels[TEXTURE_MAX_LEVELS];
+    int level_count;
+    void* data;                 // 所有级别共用的一块内存
+} texture_t;
+
+// 由行优先的ARGB像素创建纹理并生成mipmap链（2x2盒式滤波，直到1x1），内存不足时返回false
+bool texture_create(texture_t* texture, const uint32_t* pixels, int width, int height);
+void texture_free(texture_t* texture);
+
+// 第level级(x, y)处纹素的下标，坐标须在范围内（TEXTURE_TILE为4，用移位代替除法）
+static inline int texture_texel_index(const texture_level_t* level, int x, int y) {
+    int tile = (y >> 2) * level->tiles_x + (x >> 2);
+    return (tile << 4) | ((y & 3) << 2) | (x & 3);
+}
+
+static inline uint32_t texture_texel(const texture_level_t* level, int x, int y) {
+    return level->texels[texture_texel_index(level, x, y)];
+}
+
+// 按纹理坐标(u, v)采样，导数为纹理坐标在屏幕x和y方向上每像素的变化量，用于选择mip级别
+// 导数为0或无效时使用第0级
+uint32_t texture_sample(const texture_t* texture, float u, float v,
+                        float dudx, float dvdx, float dudy, float dvdy, texture_filter_t filter);
+
+// 纹理着色的参数（raster_shader_t.uniforms）
+typedef struct {
+    const texture_t* texture;
+    texture_filter_t filter;
+} texture_shader_params_t;
+
+// 输出纹理颜色的片元着色函数（fragment_shader_t），纹理坐标取属性的最后两个（UV总在末尾）
+// raster_shader_t.varyings须包含RASTER_VARYING_UV，并开启derivatives以选择mip级别
+// 同时包含RASTER_VARYING_COLOR时纹理颜色乘以插值的颜色（可用于光照）
+struct fragment;
+uint32_t texture_fragment_shader(const struct fragment* fragment, uint32_t color, const void* uniforms);
+
+#endif // TEXTURE_H
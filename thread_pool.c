@@ -0,0 +1,215 @@
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// 每个线程的任务区间[begin, end)，按缓存行对齐避免伪共享
+typedef struct {
+    _Alignas(64) pthread_mutex_t lock;
+    int begin;
+    int end;
+} task_range_t;
+
+typedef struct {
+    thread_pool_t* pool;
+    int index;
+} worker_arg_t;
+
+struct thread_pool {
+    int thread_count;
+    pthread_t* threads;
+    worker_arg_t* args;
+    task_range_t* ranges;
+
+    // 当前批次的任务，批次开始前写入，由区间锁保证对工作线程可见
+    thread_pool_task_fn fn;
+    void* ctx;
+    atomic_int remaining;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    unsigned generation;
+    bool shutdown;
+};
+
+// 从自己的区间头部取一个任务
+static bool pop_task(task_range_t* range, int* task) {
+    bool found = false;
+    pthread_mutex_lock(&range->lock);
+    if (range->begin < range->end) {
+        *task = range->begin++;
+        found = true;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+// 从其它线程区间尾部窃取一半任务放入自己的区间，返回其中第一个任务
+// 两个区间按编号顺序加锁后一起修改：窃取期间调用者可能已开始下一批并给本线程分配了新区间，
+// 此时自己的区间不为空，直接从中取任务，不能用窃取的区间覆盖它
+static bool steal_task(thread_pool_t* pool, int self, int* task) {
+    task_range_t* own = &pool->ranges[self];
+    for (int i = 1; i < pool->thread_count; i++) {
+        int other = (self + i) % pool->thread_count;
+        task_range_t* victim = &pool->ranges[other];
+        task_range_t* first = other < self ? victim : own;
+        task_range_t* second = other < self ? own : victim;
+        pthread_mutex_lock(&first->lock);
+        pthread_mutex_lock(&second->lock);
+        bool found = true;
+        int available = victim->end - victim->begin;
+        if (own->begin < own->end) {
+            *task = own->begin++;
+        } else if (available > 0) {
+            int begin = victim->end - (available + 1) / 2;
+            own->begin = begin + 1;
+            own->end = victim->end;
+            victim->end = begin;
+            *task = begin;
+        } else {
+            found = false;
+        }
+        pthread_mutex_unlock(&second->lock);
+        pthread_mutex_unlock(&first->lock);
+        if (found) return true;
+    }
+    return false;
+}
+
+// 执行任务直到所有区间都为空
+static void drain_tasks(thread_pool_t* pool, int self) {
+    int task;
+    while (pop_task(&pool->ranges[self], &task) || steal_task(pool, self, &task)) {
+        pool->fn(pool->ctx, task, self);
+        if (atomic_fetch_sub_explicit(&pool->remaining, 1, memory_order_acq_rel) == 1) {
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_signal(&pool->done_cond);
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+}
+
+static void* worker_main(void* p) {
+    worker_arg_t* arg = (worker_arg_t*)p;
+    thread_pool_t* pool = arg->pool;
+    unsigned seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        drain_tasks(pool, arg->index);
+    }
+    return NULL;
+}
+
+static int detect_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+thread_pool_t* thread_pool_create(int thread_count) {
+    if (thread_count <= 0) thread_count = detect_cpu_count();
+
+    thread_pool_t* pool = calloc(1, sizeof(thread_pool_t));
+    if (!pool) return NULL;
+    pool->thread_count = thread_count;
+    pool->ranges = aligned_alloc(_Alignof(task_range_t), sizeof(task_range_t) * thread_count);
+    pool->threads = calloc(thread_count, sizeof(pthread_t));
+    pool->args = calloc(thread_count, sizeof(worker_arg_t));
+    if (!pool->ranges || !pool->threads || !pool->args) {
+        free(pool->ranges);
+        free(pool->threads);
+        free(pool->args);
+        free(pool);
+        return NULL;
+    }
+    for (int i = 0; i < thread_count; i++) {
+        pthread_mutex_init(&pool->ranges[i].lock, NULL);
+        pool->ranges[i].begin = 0;
+        pool->ranges[i].end = 0;
+    }
+    atomic_init(&pool->remaining, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    // 0号线程是调用线程，只为其余线程创建pthread
+    for (int i = 1; i < thread_count; i++) {
+        pool->args[i] = (worker_arg_t){pool, i};
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]) != 0) {
+            pool->thread_count = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+void thread_pool_destroy(thread_pool_t* pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_mutex_destroy(&pool->ranges[i].lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->ranges);
+    free(pool->threads);
+    free(pool->args);
+    free(pool);
+}
+
+int thread_pool_size(const thread_pool_t* pool) {
+    return pool ? pool->thread_count : 1;
+}
+
+void thread_pool_run(thread_pool_t* pool, int task_count, thread_pool_task_fn fn, void* ctx) {
+    if (task_count <= 0) return;
+    if (!pool || pool->thread_count == 1 || task_count == 1) {
+        for (int i = 0; i < task_count; i++) fn(ctx, i, 0);
+        return;
+    }
+
+    pool->fn = fn;
+    pool->ctx = ctx;
+    atomic_store_explicit(&pool->remaining, task_count, memory_order_relaxed);
+
+    // 按连续区间平均分配，相邻任务（如相邻图块）留在同一线程以利用缓存
+    int n = pool->thread_count;
+    for (int i = 0; i < n; i++) {
+        task_range_t* range = &pool->ranges[i];
+        pthread_mutex_lock(&range->lock);
+        range->begin = (int)((long long)task_count * i / n);
+        range->end = (int)((long long)task_count * (i + 1) / n);
+        pthread_mutex_unlock(&range->lock);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    drain_tasks(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load_explicit(&pool->remaining, memory_order_acquire) > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,25 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// 常驻的工作窃取线程池：每个线程持有一段任务区间，
+// 自己从区间头部取任务，空闲时从其它线程区间尾部窃取一半
+
+// 任务函数：ctx为调用者上下文，task_index为任务编号，worker_index为执行线程编号（0为调用线程）
+typedef void (*thread_pool_task_fn)(void* ctx, int task_index, int worker_index);
+
+typedef struct thread_pool thread_pool_t;
+
+// 创建线程池，thread_count为线程总数（含调用线程），<=0时使用CPU核心数
+thread_pool_t* thread_pool_create(int thread_count);
+
+// 销毁线程池并等待所有工作线程退出
+void thread_pool_destroy(thread_pool_t* pool);
+
+// 线程总数（含调用线程），pool为NULL时返回1
+int thread_pool_size(const thread_pool_t* pool);
+
+// 并行执行task_count个任务，调用线程也参与执行，阻塞直到全部完成
+// pool为NULL时在调用线程上按顺序串行执行
+void thread_pool_run(thread_pool_t* pool, int task_count, thread_pool_task_fn fn, void* ctx);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,24 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 199309L
+#endif
+#include "timing.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+double time_now_ms(void) {
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+}
+#else
+#include <time.h>
+
+double time_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1.0e6;
+}
+#endif
@@ -0,0 +1,7 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+// 单调时钟，返回毫秒，用于计算时间预算和统计帧耗时
+double time_now_ms(void);
+
+#endif // TIMING_H